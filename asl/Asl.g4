@@ -1,5 +1,12 @@
 grammar Asl;
 
+// every node of the parse tree carries the index used by TreeDecoration
+options { contextSuperClass = DecoratedRuleContext; }
+
+@parser::postinclude {
+#include "../common/TreeDecoration.h"
+}
+
 //////////////////////////////////////////////////
 /// Parser Rules
 //////////////////////////////////////////////////
@@ -35,8 +35,13 @@
 #include "../common/SymTable.h"
 #include "../common/TreeDecoration.h"
 #include "../common/code.h"
+#include "../common/WorkPool.h"
 
 #include <string>
+#include <vector>
+#include <memory>     // std::unique_ptr
+#include <mutex>
+#include <utility>    // std::move
 #include <cstddef>    // std::size_t
 
 // uncomment the following line to enable debugging messages with DEBUG*
@@ -55,26 +60,86 @@ CodeGenVisitor::CodeGenVisitor(TypesMgr       & Types,
   Decorations{Decorations} {
   }
 
+void CodeGenVisitor::setSubroutineSink(std::function<void(subroutine &&)> sink) {
+  SubroutineSink = sink;
+}
+
+void CodeGenVisitor::setNumberOfThreads(unsigned n) {
+  NumThreads = n;
+}
+
+void CodeGenVisitor::setReusedSubroutines(std::vector<std::unique_ptr<subroutine>> * reused) {
+  Reused = reused;
+}
+
+void CodeGenVisitor::setSubroutinePass(std::function<void(subroutine &)> pass) {
+  SubroutinePass = pass;
+}
+
+// target of the jumps of a condition until its label is numbered (it
+// is not a valid label, so it can not clash with the generated ones)
+const std::string CodeGenVisitor::PendingLabel = "?pending";
+
 // Methods to visit each kind of node:
 //
 antlrcpp::Any CodeGenVisitor::visitProgram(AslParser::ProgramContext *ctx) {
   DEBUG_ENTER();
   code my_code;
-  SymTable::ScopeId sc = getScopeDecor(ctx);
-  Symbols.pushThisScope(sc);
-  for (auto ctxFunc : ctx->function()) { 
-    subroutine subr = visit(ctxFunc);
-    my_code.add_subroutine(subr);
-  }
-  Symbols.popScope();
+  auto emit = [&](subroutine && subr) {
+    if (SubroutineSink) SubroutineSink(std::move(subr));
+    else my_code.add_subroutine(std::move(subr));
+  };
+  // the code generation only reads the symbols and types through the
+  // decorations, so no scope is pushed and the functions are independent
+  std::vector<AslParser::FunctionContext *> functions = ctx->function();
+  auto reused = [&](std::size_t k) -> std::unique_ptr<subroutine> {
+    if (not Reused or k >= Reused->size()) return nullptr;
+    return std::move((*Reused)[k]);
+  };
+  WorkPool pool(NumThreads);
+  if (pool.getNumberOfThreads() == 1 or functions.size() <= 1) {
+    for (std::size_t k = 0; k < functions.size(); ++k) { 
+      if (auto subr = reused(k)) {
+        emit(std::move(*subr));
+        continue;
+      }
+      subroutine subr = visit(functions[k]);
+      if (SubroutinePass) SubroutinePass(subr);
+      emit(std::move(subr));
+    }
+    DEBUG_EXIT();
+    return my_code;
+  }
+
+  // each function is generated by a visitor of its own, with the
+  // operand pool of this thread. The finished ones are emitted as soon
+  // as all the previous ones have been
+  std::vector<std::unique_ptr<subroutine>> done(functions.size());
+  std::size_t next = 0;
+  std::mutex lock;
+  std::shared_ptr<operandPool> names = operandPool::get_current();
+  pool.run(functions.size(), [&](std::size_t k) {
+      operandPool::scope use(names);
+      std::unique_ptr<subroutine> subr = reused(k);
+      if (not subr) {
+        CodeGenVisitor generator(Types, Symbols, Decorations);
+        subroutine s = generator.visit(functions[k]);
+        if (SubroutinePass) SubroutinePass(s);
+        subr.reset(new subroutine(std::move(s)));
+      }
+      std::lock_guard<std::mutex> guard(lock);
+      done[k] = std::move(subr);
+      while (next < done.size() and done[next]) {
+        emit(std::move(*done[next]));
+        done[next++].reset();
+      }
+    });
   DEBUG_EXIT();
   return my_code;
 }
 
 antlrcpp::Any CodeGenVisitor::visitFunction(AslParser::FunctionContext *ctx) {
   DEBUG_ENTER();
-  SymTable::ScopeId sc = getScopeDecor(ctx);
-  Symbols.pushThisScope(sc);
   subroutine subr(ctx->ID()->getText());
   codeCounters.reset();
   
@@ -94,9 +159,8 @@ antlrcpp::Any CodeGenVisitor::visitFunction(AslParser::FunctionContext *ctx) {
     subr.add_var(onevar);
   }
   instructionList && code = visit(ctx->statements());
-  code = code || instruction(instruction::RETURN());
-  subr.set_instructions(code);
-  Symbols.popScope();
+  code += instruction::RETURN();
+  subr.set_instructions(std::move(code));
   DEBUG_EXIT();
   return subr;
 }
@@ -113,29 +177,33 @@ antlrcpp::Any CodeGenVisitor::visitFunction_call(AslParser::Function_callContext
     std::string addr          = codAts.addr;
     instructionList & codeI   = codAts.code;
     
-    code = code || codeI;
+    code += codeI;
     TypesMgr::TypeId paramT = getTypeDecor(ctx->expr(i));
     
     
     if(Types.isArrayTy(paramT)) {
+      // an array parameter already holds the address of the array
       std::string arrayAddrTemp = "%"+codeCounters.newTEMP();
-      code = code || instruction::ALOAD(arrayAddrTemp, addr);
-      code = code || instruction::PUSH(arrayAddrTemp);
+      if(Symbols.isParameterClass(getSymbolDecor(ctx->expr(i))))
+        code += instruction::LOAD(arrayAddrTemp, addr);
+      else
+        code += instruction::ALOAD(arrayAddrTemp, addr);
+      code += instruction::PUSH(arrayAddrTemp);
     }else if(Types.isFloatTy(paramTypes[i]) and Types.isIntegerTy(paramT)){
       std::string floatTemp = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLOAT(floatTemp, addr) || instruction::PUSH(floatTemp);
+      code += instruction::FLOAT(floatTemp, addr) || instruction::PUSH(floatTemp);
     }else{
-      code = code || instruction::PUSH(addr);
+      code += instruction::PUSH(addr);
     }
   }
-  code = code || instruction::CALL(functionName);
+  code += instruction::CALL(functionName);
   
   for(uint i = 0; i < ctx->expr().size(); i++){ 
-    code = code || instruction::POP();
+    code += instruction::POP();
   }
   
   std::string temp = "%"+codeCounters.newTEMP();
-  code = code || instruction::POP(temp);
+  code += instruction::POP(temp);
   
   CodeAttribs atts(temp, "", code);
   
@@ -149,7 +217,7 @@ antlrcpp::Any CodeGenVisitor::visitReturnStmt(AslParser::ReturnStmtContext *ctx)
     CodeAttribs && codAts = visit(ctx->expr());
     std::string addr = codAts.addr;
     instructionList & codeR = codAts.code;
-    code = codeR || instruction::LOAD("Ret",addr) || instruction::RETURN();
+    code = std::move(codeR) || instruction::LOAD("Ret",addr) || instruction::RETURN();
   }
   return code;
 }
@@ -195,7 +263,7 @@ antlrcpp::Any CodeGenVisitor::visitStatements(AslParser::StatementsContext *ctx)
   instructionList code;
   for (auto stCtx : ctx->statement()) {
     instructionList && codeS = visit(stCtx);
-    code = code || codeS;
+    code += codeS;
   }
   DEBUG_EXIT();
   return code;
@@ -219,13 +287,13 @@ antlrcpp::Any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx)
   std::string addrL = addr1;
   std::string addrR = addr2;
   
-  if (Types.isArrayTy(tid1) and Symbols.isParameterClass(addr1)) {
+  if (Types.isArrayTy(tid1) and Symbols.isParameterClass(getSymbolDecor(ctx->left_expr()))) {
     addrL = "%"+codeCounters.newTEMP();
-    code = instruction::LOAD(addrL, addr1);
+    code += instruction::LOAD(addrL, addr1);
   }
-  if (Types.isArrayTy(tid2) and Symbols.isParameterClass(addr2)) {
+  if (Types.isArrayTy(tid2) and Symbols.isParameterClass(getSymbolDecor(ctx->expr()))) {
     addrR = "%"+codeCounters.newTEMP();
-    code = instruction::LOAD(addrR, addr2);
+    code += instruction::LOAD(addrR, addr2);
   }
   
   if (Types.isArrayTy(tid1) and offs1.empty()) {
@@ -233,34 +301,54 @@ antlrcpp::Any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx)
     std::string offsetTemp = "%"+codeCounters.newTEMP();
     std::string arrayAccessTemp = "%"+codeCounters.newTEMP();
     
-    for (int i = 0; i < arraySize; i++){
-      code = code || instruction::ILOAD(offsetTemp, std::to_string(i)) || instruction::LOADX(arrayAccessTemp, addrR, offsetTemp) || instruction::XLOAD(addrL, offsetTemp, arrayAccessTemp);
+    if (arraySize <= ArrayCopyUnroll) {
+      for (int i = 0; i < arraySize; i++){
+        code += instruction::ILOAD(offsetTemp, std::to_string(i)) || instruction::LOADX(arrayAccessTemp, addrR, offsetTemp) || instruction::XLOAD(addrL, offsetTemp, arrayAccessTemp);
+      }
+    }else{
+      // a loop over the elements, whose size does not depend on the
+      // size of the array
+      std::string sizeTemp = "%"+codeCounters.newTEMP();
+      std::string oneTemp = "%"+codeCounters.newTEMP();
+      std::string condTemp = "%"+codeCounters.newTEMP();
+      std::string label = "copy"+codeCounters.newLabelWHILE();
+      std::string labelEndCopy = "end"+label;
+      code += instruction::ILOAD(offsetTemp, "0") || instruction::ILOAD(sizeTemp, std::to_string(arraySize)) ||
+        instruction::ILOAD(oneTemp, "1") || instruction::LABEL(label) ||
+        instruction::LT(condTemp, offsetTemp, sizeTemp) || instruction::FJUMP(condTemp, labelEndCopy) ||
+        instruction::LOADX(arrayAccessTemp, addrR, offsetTemp) || instruction::XLOAD(addrL, offsetTemp, arrayAccessTemp) ||
+        instruction::ADD(offsetTemp, offsetTemp, oneTemp) || instruction::UJUMP(label) ||
+        instruction::LABEL(labelEndCopy);
     }
+    DEBUG_EXIT();
+    return std::move(code1) || code2 || code;
   }
   
   bool fl = false;
   std::string temp = "%"+codeCounters.newTEMP();
   
   if(Types.isFloatTy(tid1) and Types.isIntegerTy(tid2)){
-    code = code || instruction::FLOAT(temp, addrR);
+    code += instruction::FLOAT(temp, addrR);
     fl = true;
   }
   
   if(ctx->left_expr()->expr()){
-    code = code || instruction::XLOAD(addrL, offs1, addrR);
+    code += instruction::XLOAD(addrL, offs1, addrR);
   }else{ 
-    code = code || instruction::LOAD(addrL, (fl ? temp : addrR));
+    code += instruction::LOAD(addrL, (fl ? temp : addrR));
   }
   DEBUG_EXIT();
-  return code1 || code2 || code;
+  return std::move(code1) || code2 || code;
 }
 
 antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
   DEBUG_ENTER();
   instructionList code;
-  CodeAttribs     && codAtsE = visit(ctx->expr());
-  std::string          addr1 = codAtsE.addr;
-  instructionList &    code1 = codAtsE.code;
+  // the condition jumps to the else part (or to the end) if it is
+  // false. The label is numbered after the condition and the then part
+  // (so nested ifs are numbered inner first): until then the jumps go
+  // to PendingLabel
+  instructionList &&   code1 = codeJump(ctx->expr(), false, PendingLabel);
   instructionList &&   code2 = visit(ctx->statements(0));
   
   std::string label = codeCounters.newLabelIF();
@@ -269,11 +357,14 @@ antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
   if(ctx->statements(1)){
     instructionList && code3 = visit(ctx->statements(1));
     std::string labelElse = "else"+label;
+    setJumpTarget(code1, PendingLabel, labelElse);
     
-    code =   code1 || instruction::FJUMP(addr1, labelElse) ||
-      code2 || instruction::LABEL(labelElse) || code3 || instruction::LABEL(labelEndIf);
+    code =   std::move(code1) ||
+      code2 || instruction::UJUMP(labelEndIf) ||
+      instruction::LABEL(labelElse) || code3 || instruction::LABEL(labelEndIf);
   }else{
-    code =   code1 || instruction::FJUMP(addr1, labelEndIf) || 
+    setJumpTarget(code1, PendingLabel, labelEndIf);
+    code =   std::move(code1) || 
       code2 || instruction::LABEL(labelEndIf);
   }
   DEBUG_EXIT();
@@ -283,13 +374,13 @@ antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
 antlrcpp::Any CodeGenVisitor::visitWhileStmt(AslParser::WhileStmtContext *ctx) {
   DEBUG_ENTER();
   instructionList code;
-  CodeAttribs     && codAtsE = visit(ctx->expr());
-  std::string          addr1 = codAtsE.addr;
-  instructionList &    code1 = codAtsE.code;
+  // numbered after the condition and the body, like the ifs
+  instructionList &&   code1 = codeJump(ctx->expr(), false, PendingLabel);
   instructionList &&   code2 = visit(ctx->statements());
   std::string label = "while"+codeCounters.newLabelWHILE();
   std::string labelEndWhile = "end"+label;
-  code = instruction::LABEL(label) || code1 || instruction::FJUMP(addr1, labelEndWhile) ||
+  setJumpTarget(code1, PendingLabel, labelEndWhile);
+  code = instruction::LABEL(label) || code1 ||
     code2 || instruction::UJUMP(label) || instruction::LABEL(labelEndWhile);
   DEBUG_EXIT();
   return code;
@@ -302,39 +393,44 @@ antlrcpp::Any CodeGenVisitor::visitProcCall(AslParser::ProcCallContext *ctx) {
   TypesMgr::TypeId procType = getTypeDecor(ctx->ident());
   std::vector<TypesMgr::TypeId> paramTypes = Types.getFuncParamsTypes(procType);
   
+  // space for the result (ignored) of a function called as a procedure
+  if(not Types.isVoidFunction(procType)){
+    code += instruction::PUSH();
+  }
+  
   for(uint i = 0; i < ctx->expr().size(); i++){
     CodeAttribs && codAts      = visit(ctx->expr(i));
     std::string addr          = codAts.addr;
     instructionList & codeI   = codAts.code;
     
-    code = code || codeI;
+    code += codeI;
     TypesMgr::TypeId paramT = getTypeDecor(ctx->expr(i));
     
     if(Types.isArrayTy(paramT)) {
+      // an array parameter already holds the address of the array
       std::string arrayAddrTemp = "%"+codeCounters.newTEMP();
-      code = code   || instruction::ALOAD(arrayAddrTemp, addr)
-                    || instruction::PUSH(arrayAddrTemp);
+      if(Symbols.isParameterClass(getSymbolDecor(ctx->expr(i))))
+        code += instruction::LOAD(arrayAddrTemp, addr);
+      else
+        code += instruction::ALOAD(arrayAddrTemp, addr);
+      code += instruction::PUSH(arrayAddrTemp);
     }else if(Types.isFloatTy(paramTypes[i]) and Types.isIntegerTy(paramT)){
       std::string floatTemp = "%"+codeCounters.newTEMP();
-      code = code   || instruction::FLOAT(floatTemp, addr) 
-                    || instruction::PUSH(floatTemp);
+      code += instruction::FLOAT(floatTemp, addr) 
+           || instruction::PUSH(floatTemp);
     }else{
-      code = code   || instruction::PUSH(addr);
+      code += instruction::PUSH(addr);
     }
   }
   
-  if(not Types.isVoidTy(procType)){
-    code = code || instruction::PUSH();
-  }
-  
-  code = code || instruction::CALL(name);
+  code += instruction::CALL(name);
   
   for(uint i = 0; i < ctx->expr().size(); i++){ 
-    code = code || instruction::POP();
+    code += instruction::POP();
   }
   
-  if(not Types.isVoidTy(procType)){
-    code = code || instruction::POP();
+  if(not Types.isVoidFunction(procType)){
+    code += instruction::POP();
   }
   
   DEBUG_EXIT();
@@ -354,14 +450,14 @@ antlrcpp::Any CodeGenVisitor::visitReadStmt(AslParser::ReadStmtContext *ctx) {
     : addr1;
   
   if(Types.isIntegerTy(tid1) or Types.isBooleanTy(tid1)){
-    code = code1 || instruction::READI(temp);
+    code += instruction::READI(temp);
   }else if(Types.isFloatTy(tid1)){
-    code = code1 || instruction::READF(temp);
+    code += instruction::READF(temp);
   }else{
-    code = code1 || instruction::READC(temp);
+    code += instruction::READC(temp);
   }
   if(ctx->left_expr()->expr()){
-    code = code || instruction::XLOAD(addr1, offs1, temp);
+    code += instruction::XLOAD(addr1, offs1, temp);
   }
   DEBUG_EXIT();
   return code;
@@ -376,11 +472,11 @@ antlrcpp::Any CodeGenVisitor::visitWriteExpr(AslParser::WriteExprContext *ctx) {
   instructionList &    code = code1;
   TypesMgr::TypeId tid1 = getTypeDecor(ctx->expr());
   if(Types.isCharacterTy(tid1)){
-    code = code1 || instruction::WRITEC(addr1);
+    code += instruction::WRITEC(addr1);
   }else if(Types.isFloatTy(tid1)){
-    code = code1 || instruction::WRITEF(addr1);
+    code += instruction::WRITEF(addr1);
   }else{
-    code = code1 || instruction::WRITEI(addr1);
+    code += instruction::WRITEI(addr1);
   }
   DEBUG_EXIT();
   return code;
@@ -394,26 +490,23 @@ antlrcpp::Any CodeGenVisitor::visitWriteString(AslParser::WriteStringContext *ct
   int i = 1;
   while (i < int(s.size())-1) {
     if (s[i] != '\\') {
-      code = code ||
-        instruction::CHLOAD(temp, s.substr(i,1)) ||
+      code += instruction::CHLOAD(temp, s.substr(i,1)) ||
         instruction::WRITEC(temp);
       i += 1;
     }
     else {
       assert(i < int(s.size())-2);
       if (s[i+1] == 'n') {
-        code = code || instruction::WRITELN();
+        code += instruction::WRITELN();
         i += 2;
       }
       else if (s[i+1] == 't' or s[i+1] == '"' or s[i+1] == '\\') {
-        code = code ||
-          instruction::CHLOAD(temp, s.substr(i,2)) ||
+        code += instruction::CHLOAD(temp, s.substr(i,2)) ||
           instruction::WRITEC(temp);
         i += 2;
       }
       else {
-        code = code ||
-          instruction::CHLOAD(temp, s.substr(i,1)) ||
+        code += instruction::CHLOAD(temp, s.substr(i,1)) ||
           instruction::WRITEC(temp);
         i += 1;
       }
@@ -432,16 +525,16 @@ antlrcpp::Any CodeGenVisitor::visitLeft_expr(AslParser::Left_exprContext *ctx) {
   
   if(ctx->expr()){
     CodeAttribs && codExpr = visit(ctx->expr());
-    code = code || codExpr.code;
+    code += codExpr.code;
     offs = codExpr.addr; 
-    if(Symbols.isParameterClass(addr)){
+    if(Symbols.isParameterClass(getSymbolDecor(ctx->ident()))){
       std::string temp = "%"+codeCounters.newTEMP();
-      code = code || instruction::LOAD(temp, addr);
+      code += instruction::LOAD(temp, addr);
       addr = temp;
     }
   }
   
-  CodeAttribs atts(addr, offs, code);
+  CodeAttribs atts(addr, offs, std::move(code));
   
   DEBUG_EXIT();
   return atts;
@@ -457,15 +550,15 @@ antlrcpp::Any CodeGenVisitor::visitArray_access(AslParser::Array_accessContext *
   std::string addrE = codAtsE.addr;
   
   std::string temp = "%"+codeCounters.newTEMP();
-  if(Symbols.isParameterClass(addr)){
+  if(Symbols.isParameterClass(getSymbolDecor(ctx->ident()))){
     std::string refTemp = "%"+codeCounters.newTEMP();
-    code =    code || codeExpr || instruction::LOAD(refTemp, addr) || 
+    code += codeExpr || instruction::LOAD(refTemp, addr) || 
       instruction::LOADX(temp, refTemp, addrE);      
   }else{
-    code = code || codeExpr || instruction::LOADX(temp, addr, addrE);
+    code += codeExpr || instruction::LOADX(temp, addr, addrE);
   }
   
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
   
   DEBUG_EXIT();
   return codAts;
@@ -479,45 +572,45 @@ antlrcpp::Any CodeGenVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx)
   CodeAttribs     && codAt2 = visit(ctx->expr(1));
   std::string         addr2 = codAt2.addr;
   instructionList &   code2 = codAt2.code;
-  instructionList &&   code = code1 || code2;
+  instructionList &&   code = std::move(code1) || code2;
   TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
   TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
   TypesMgr::TypeId  t = getTypeDecor(ctx);
   std::string temp = "%"+codeCounters.newTEMP();
   if(Types.isIntegerTy(t)){
     if (ctx->MUL())
-      code = code || instruction::MUL(temp, addr1, addr2);
+      code += instruction::MUL(temp, addr1, addr2);
     else if (ctx->DIV())
-      code = code || instruction::DIV(temp, addr1, addr2);
+      code += instruction::DIV(temp, addr1, addr2);
     else if (ctx->SUB())
-      code = code || instruction::SUB(temp, addr1, addr2);
+      code += instruction::SUB(temp, addr1, addr2);
     else if (ctx->PLUS())
-      code = code || instruction::ADD(temp, addr1, addr2);
+      code += instruction::ADD(temp, addr1, addr2);
     else{
-      code = code   || instruction::DIV(temp, addr1, addr2)
-                    || instruction::MUL(temp, temp, addr2)
-                    || instruction::SUB(temp, addr1, temp);
+      code += instruction::DIV(temp, addr1, addr2)
+           || instruction::MUL(temp, temp, addr2)
+           || instruction::SUB(temp, addr1, temp);
     }
   }else{
     std::string addrF1 = addr1;
     std::string addrF2 = addr2;
     if(Types.isIntegerTy(t1) and Types.isFloatTy(t2)){
       addrF1 = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLOAT(addrF1, addr1);
+      code += instruction::FLOAT(addrF1, addr1);
     }else if(Types.isIntegerTy(t2) and Types.isFloatTy(t1)){
       addrF2 = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLOAT(addrF2, addr2);
+      code += instruction::FLOAT(addrF2, addr2);
     }
     if (ctx->MUL())
-      code = code || instruction::FMUL(temp, addrF1, addrF2);
+      code += instruction::FMUL(temp, addrF1, addrF2);
     else if (ctx->DIV())
-      code = code || instruction::FDIV(temp, addrF1, addrF2);
+      code += instruction::FDIV(temp, addrF1, addrF2);
     else if (ctx->SUB())
-      code = code || instruction::FSUB(temp, addrF1, addrF2);
+      code += instruction::FSUB(temp, addrF1, addrF2);
     else
-      code = code || instruction::FADD(temp, addrF1, addrF2);
+      code += instruction::FADD(temp, addrF1, addrF2);
   }
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
   DEBUG_EXIT();
   return codAts;
 }
@@ -530,56 +623,56 @@ antlrcpp::Any CodeGenVisitor::visitRelational(AslParser::RelationalContext *ctx)
   CodeAttribs     && codAt2 = visit(ctx->expr(1));
   std::string         addr2 = codAt2.addr;
   instructionList &   code2 = codAt2.code;
-  instructionList &&   code = code1 || code2;
+  instructionList &&   code = std::move(code1) || code2;
   TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
   TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
   std::string temp = "%"+codeCounters.newTEMP();
   
   if(not Types.isFloatTy(t1) and not Types.isFloatTy(t2)){
     if(ctx->EQUAL()){
-      code = code || instruction::EQ(temp, addr1, addr2);
+      code += instruction::EQ(temp, addr1, addr2);
     }else if(ctx->NE()){
-      code = code || instruction::EQ(temp, addr1, addr2);
-      code = code || instruction::NOT(temp, temp);
+      code += instruction::EQ(temp, addr1, addr2);
+      code += instruction::NOT(temp, temp);
     }else if(ctx->LT()){
-      code = code || instruction::LT(temp, addr1, addr2);
+      code += instruction::LT(temp, addr1, addr2);
     }else if(ctx->LTE()){
-      code = code || instruction::LE(temp, addr1, addr2);
+      code += instruction::LE(temp, addr1, addr2);
     }else if(ctx->GT()){
-      code = code || instruction::LE(temp, addr1, addr2);
-      code = code || instruction::NOT(temp, temp);
+      code += instruction::LE(temp, addr1, addr2);
+      code += instruction::NOT(temp, temp);
     }else if(ctx->GTE()){
-      code = code || instruction::LT(temp, addr1, addr2);
-      code = code || instruction::NOT(temp, temp);
+      code += instruction::LT(temp, addr1, addr2);
+      code += instruction::NOT(temp, temp);
     }
   }else{
     std::string addrF1 = addr1;
     std::string addrF2 = addr2;
     if(Types.isIntegerTy(t1) and Types.isFloatTy(t2)){
       addrF1 = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLOAT(addrF1, addr1);
+      code += instruction::FLOAT(addrF1, addr1);
     }else if(Types.isIntegerTy(t2) and Types.isFloatTy(t1)){
       addrF2 = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLOAT(addrF2, addr2);
+      code += instruction::FLOAT(addrF2, addr2);
     }
     if(ctx->EQUAL()){
-      code = code || instruction::FEQ(temp, addrF1, addrF2);
+      code += instruction::FEQ(temp, addrF1, addrF2);
     }else if(ctx->NE()){
-      code = code || instruction::FEQ(temp, addrF1, addrF2);
-      code = code || instruction::NOT(temp, temp);
+      code += instruction::FEQ(temp, addrF1, addrF2);
+      code += instruction::NOT(temp, temp);
     }else if(ctx->LT()){
-      code = code || instruction::FLT(temp, addrF1, addrF2);
+      code += instruction::FLT(temp, addrF1, addrF2);
     }else if(ctx->LTE()){
-      code = code || instruction::FLE(temp, addrF1, addrF2);
+      code += instruction::FLE(temp, addrF1, addrF2);
     }else if(ctx->GT()){
-      code = code || instruction::FLE(temp, addrF1, addrF2);
-      code = code || instruction::NOT(temp, temp);
+      code += instruction::FLE(temp, addrF1, addrF2);
+      code += instruction::NOT(temp, temp);
     }else if(ctx->GTE()){
-      code = code || instruction::FLT(temp, addrF1, addrF2);
-      code = code || instruction::NOT(temp, temp);
+      code += instruction::FLT(temp, addrF1, addrF2);
+      code += instruction::NOT(temp, temp);
     }
   }
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
   DEBUG_EXIT();
   return codAts;
 }
@@ -589,18 +682,38 @@ antlrcpp::Any CodeGenVisitor::visitLogical(AslParser::LogicalContext *ctx) {
   CodeAttribs     && codAt1 = visit(ctx->expr(0));
   std::string         addr1 = codAt1.addr;
   instructionList &   code1 = codAt1.code;
+  std::string temp = "%"+codeCounters.newTEMP();
+  
+  // the second operand is only evaluated if the first one does not
+  // give the result. When that can not be told apart (it has no
+  // calls, nor anything that may stop the program) both are evaluated
+  if(mayHaveEffects(ctx->expr(1))){
+    std::string labelEnd = (ctx->AND() ? "and" : "or")+codeCounters.newLabelIF();
+    CodeAttribs     && codAt2 = visit(ctx->expr(1));
+    instructionList && code = std::move(code1) || instruction::LOAD(temp, addr1);
+    if(ctx->AND()){
+      code += instruction::FJUMP(temp, labelEnd);
+    }else{
+      std::string notTemp = "%"+codeCounters.newTEMP();
+      code += instruction::NOT(notTemp, temp) || instruction::FJUMP(notTemp, labelEnd);
+    }
+    code += codAt2.code || instruction::LOAD(temp, codAt2.addr) || instruction::LABEL(labelEnd);
+    CodeAttribs codAts(temp, "", std::move(code));
+    DEBUG_EXIT();
+    return codAts;
+  }
+  
   CodeAttribs     && codAt2 = visit(ctx->expr(1));
   std::string         addr2 = codAt2.addr;
   instructionList &   code2 = codAt2.code;
-  instructionList &&   code = code1 || code2;
-  std::string temp = "%"+codeCounters.newTEMP();
+  instructionList &&   code = std::move(code1) || code2;
   
   if(ctx->AND()){
-    code = code || instruction::AND(temp, addr1, addr2);
+    code += instruction::AND(temp, addr1, addr2);
   }else{
-    code = code || instruction::OR(temp, addr1, addr2);
+    code += instruction::OR(temp, addr1, addr2);
   }
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
   DEBUG_EXIT();
   return codAts;
 }
@@ -614,16 +727,16 @@ antlrcpp::Any CodeGenVisitor::visitUnary(AslParser::UnaryContext *ctx) {
   std::string temp = "%"+codeCounters.newTEMP();
   
   if(ctx->NOT()){
-    code = code || instruction::NOT(temp, addr);
+    code += instruction::NOT(temp, addr);
   }else if(ctx->SUB()){
     if(not Types.isFloatTy(getTypeDecor(ctx->expr()))){
-      code = code || instruction::NEG(temp, addr);
+      code += instruction::NEG(temp, addr);
     }else{
-      code = code || instruction::FNEG(temp,addr);
+      code += instruction::FNEG(temp,addr);
     }
   }
   
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
   
   DEBUG_EXIT();
   return codAts;
@@ -654,7 +767,7 @@ antlrcpp::Any CodeGenVisitor::visitValue(AslParser::ValueContext *ctx) {
       code = instruction::LOAD(temp, "0");
     }
   }
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
   DEBUG_EXIT();
   return codAts;
 }
@@ -674,14 +787,87 @@ antlrcpp::Any CodeGenVisitor::visitIdent(AslParser::IdentContext *ctx) {
 }
 
 
+// Code of the conditions of if and while: jumps to 'label' when the
+// boolean expression 'ctx' is 'jumpIf', and goes on otherwise. The
+// operands of and/or are evaluated with short-circuit, by jumping
+// over the second one when the first one gives the result
+instructionList CodeGenVisitor::codeJump(AslParser::ExprContext *ctx, bool jumpIf,
+                                         const std::string & label) {
+  if(auto par = dynamic_cast<AslParser::ParenthesisContext *>(ctx)){
+    return codeJump(par->expr(), jumpIf, label);
+  }
+  auto un = dynamic_cast<AslParser::UnaryContext *>(ctx);
+  if(un and un->NOT()){
+    return codeJump(un->expr(), not jumpIf, label);
+  }
+  if(auto log = dynamic_cast<AslParser::LogicalContext *>(ctx)){
+    // "a and b" is false if a is false, "a or b" is true if a is true
+    bool decides = log->OR() != nullptr;
+    if(jumpIf == decides){
+      instructionList && code1 = codeJump(log->expr(0), jumpIf, label);
+      return std::move(code1) || codeJump(log->expr(1), jumpIf, label);
+    }
+    std::string labelSkip = (log->AND() ? "and" : "or")+codeCounters.newLabelIF();
+    instructionList && code1 = codeJump(log->expr(0), decides, labelSkip);
+    return std::move(code1) || codeJump(log->expr(1), jumpIf, label) || instruction::LABEL(labelSkip);
+  }
+  CodeAttribs && codAts = visit(ctx);
+  instructionList & code = codAts.code;
+  if(jumpIf){
+    std::string temp = "%"+codeCounters.newTEMP();
+    code += instruction::NOT(temp, codAts.addr) || instruction::FJUMP(temp, label);
+  }else{
+    code += instruction::FJUMP(codAts.addr, label);
+  }
+  return code;
+}
+
+// Make the jumps of 'code' to the label 'from' go to 'to' instead
+void CodeGenVisitor::setJumpTarget(instructionList & code, const std::string & from,
+                                   const std::string & to) {
+  operand opFrom(from), opTo(to);
+  for(auto & i : code){
+    if(i.oper == instruction::_UJUMP and i.arg1 == opFrom){
+      i.arg1 = opTo;
+    }else if(i.oper == instruction::_FJUMP and i.arg2 == opFrom){
+      i.arg2 = opTo;
+    }
+  }
+}
+
+// True if evaluating 'ctx' may do something besides computing its
+// value: calling a function, or stopping the program (a division by
+// zero, an array access out of its bounds)
+bool CodeGenVisitor::mayHaveEffects(AslParser::ExprContext *ctx) {
+  if(dynamic_cast<AslParser::Function_callContext *>(ctx) or
+     dynamic_cast<AslParser::Array_accessContext *>(ctx)){
+    return true;
+  }
+  auto ar = dynamic_cast<AslParser::ArithmeticContext *>(ctx);
+  if(ar and (ar->DIV() or ar->MOD())){
+    return true;
+  }
+  for(auto child : ctx->children){
+    auto e = dynamic_cast<AslParser::ExprContext *>(child);
+    if(e and mayHaveEffects(e)){
+      return true;
+    }
+  }
+  return false;
+}
+
+
 // Getters for the necessary tree node atributes:
-//   Scope and Type
+//   Scope, Type and Symbol
 SymTable::ScopeId CodeGenVisitor::getScopeDecor(antlr4::ParserRuleContext *ctx) const {
   return Decorations.getScope(ctx);
 }
 TypesMgr::TypeId CodeGenVisitor::getTypeDecor(antlr4::ParserRuleContext *ctx) const {
   return Decorations.getType(ctx);
 }
+SymTable::SymbolId CodeGenVisitor::getSymbolDecor(antlr4::ParserRuleContext *ctx) const {
+  return Decorations.getSymbol(ctx);
+}
 
 
 // Constructors of the class CodeAttribs:
@@ -695,5 +881,5 @@ CodeGenVisitor::CodeAttribs::CodeAttribs(const std::string & addr,
 CodeGenVisitor::CodeAttribs::CodeAttribs(const std::string & addr,
                                          const std::string & offs,
                                          instructionList && code) :
-  addr{addr}, offs{offs}, code{code} {
+  addr{addr}, offs{offs}, code{std::move(code)} {
   }
@@ -9,6 +9,9 @@
 #include "../common/code.h"
 
 #include <string>
+#include <functional>
+#include <vector>
+#include <memory>
 
 // using namespace std;
 
@@ -23,6 +26,11 @@
 // computed and decorate the parse tree. In this visit, if some node/method
 // does not have an associated task, it does not have to be visited/called
 // so no redefinition is needed.
+//
+// The state of the generation of a function (the counters of labels
+// and temporals) lives in the visitor, and it is reset at the start
+// of each function. So the functions can also be generated in parallel,
+// each one by a visitor of its own, with the same result.
 
 class CodeGenVisitor final : public AslBaseVisitor {
 
@@ -33,6 +41,26 @@ public:
 		 SymTable       & Symbols,
 		 TreeDecoration & Decorations);
 
+  // Set a function that receives each subroutine as soon as it has
+  // been generated, so that it can be written (and released) before
+  // generating the next one. Then visitProgram returns an empty code
+  void setSubroutineSink(std::function<void(subroutine &&)> sink);
+
+  // Set the number of threads used to generate the functions (1 by
+  // default, 0 means one per processor). The subroutines are still
+  // returned (or given to the sink) in the order of the program
+  void setNumberOfThreads(unsigned n);
+
+  // Set the subroutines already generated for some functions (by
+  // their position in the program) in a previous compilation, which
+  // are emitted (moved from 'reused') instead of generating them
+  void setReusedSubroutines(std::vector<std::unique_ptr<subroutine>> * reused);
+
+  // Set a function applied to each new subroutine as soon as it has
+  // been generated (the optimizations), in the thread that generated
+  // it. The reused subroutines are not given to it
+  void setSubroutinePass(std::function<void(subroutine &)> pass);
+
   // Methods to visit each kind of node:
   antlrcpp::Any visitProgram(AslParser::ProgramContext *ctx);
   antlrcpp::Any visitFunction(AslParser::FunctionContext *ctx);
@@ -68,11 +96,30 @@ private:
   SymTable        & Symbols;
   TreeDecoration  & Decorations;
   counters          codeCounters;
+  std::function<void(subroutine &&)> SubroutineSink;
+  unsigned          NumThreads = 1;
+  std::vector<std::unique_ptr<subroutine>> * Reused = nullptr;
+  std::function<void(subroutine &)> SubroutinePass;
+
+  // whole arrays of up to this size are copied element by element,
+  // the bigger ones by a loop
+  static const int  ArrayCopyUnroll = 16;
 
   // Getters for the necessary tree node atributes:
-  //   Scope and Type
-  SymTable::ScopeId getScopeDecor (antlr4::ParserRuleContext *ctx) const;
-  TypesMgr::TypeId  getTypeDecor  (antlr4::ParserRuleContext *ctx) const;
+  //   Scope, Type and Symbol
+  SymTable::ScopeId  getScopeDecor  (antlr4::ParserRuleContext *ctx) const;
+  TypesMgr::TypeId   getTypeDecor   (antlr4::ParserRuleContext *ctx) const;
+  SymTable::SymbolId getSymbolDecor (antlr4::ParserRuleContext *ctx) const;
+
+  // Code of a condition that jumps to 'label' if it is 'jumpIf' (with
+  // short-circuit evaluation of and/or)
+  instructionList codeJump (AslParser::ExprContext *ctx, bool jumpIf, const std::string & label);
+  // Label of the jumps of a condition whose target is not numbered yet
+  static const std::string PendingLabel;
+  // Make the jumps to the label 'from' go to 'to'
+  static void setJumpTarget (instructionList & code, const std::string & from, const std::string & to);
+  // True if the evaluation of an expression may have an effect
+  static bool mayHaveEffects (AslParser::ExprContext *ctx);
 
 
   //////////////////////////////////////////////////////////////////
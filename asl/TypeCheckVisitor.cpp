@@ -7,8 +7,12 @@
 #include "../common/TreeDecoration.h"
 #include "../common/SemErrors.h"
 
+#include "../common/WorkPool.h"
+
 #include <iostream>
 #include <string>
+#include <vector>
+#include <memory>     // std::unique_ptr
 
 // uncomment the following line to enable debugging messages with DEBUG*
 // #define DEBUG_BUILD
@@ -25,7 +29,16 @@ TypeCheckVisitor::TypeCheckVisitor(TypesMgr       & Types,
   Types{Types},
   Symbols {Symbols},
   Decorations{Decorations},
-  Errors{Errors} {
+  Errors{Errors},
+  ReturnTy{Types.createVoidTy()} {
+}
+
+void TypeCheckVisitor::setNumberOfThreads(unsigned n) {
+  NumThreads = n;
+}
+
+void TypeCheckVisitor::setSkippedFunctions(const std::vector<bool> & skipped) {
+  Skipped = skipped;
 }
 
 // Methods to visit each kind of node:
@@ -34,11 +47,31 @@ antlrcpp::Any TypeCheckVisitor::visitProgram(AslParser::ProgramContext *ctx) {
   DEBUG_ENTER();
   SymTable::ScopeId sc = getScopeDecor(ctx);
   Symbols.pushThisScope(sc);  
-  for (auto ctxFunc : ctx->function()) { 
-    visit(ctxFunc);
+  Scopes.push_back(sc);
+  std::vector<AslParser::FunctionContext *> functions = ctx->function();
+  auto skipped = [&](std::size_t k) { return k < Skipped.size() and Skipped[k]; };
+  WorkPool pool(NumThreads);
+  if (pool.getNumberOfThreads() == 1 or functions.size() <= 1) {
+    for (std::size_t k = 0; k < functions.size(); ++k) { 
+      if (not skipped(k)) visit(functions[k]);
+    }
+  }
+  else {
+    // each function is checked by a visitor of its own, and its errors
+    // are added in the order of the functions (as if it were serial)
+    std::vector<std::unique_ptr<SemErrors>> funcErrors(functions.size());
+    pool.run(functions.size(), [&](std::size_t k) {
+        funcErrors[k].reset(new SemErrors);
+        if (skipped(k)) return;
+        TypeCheckVisitor checker(Types, Symbols, Decorations, *funcErrors[k]);
+        checker.Scopes = Scopes;
+        checker.visit(functions[k]);
+      });
+    for (auto & errors : funcErrors) Errors.append(*errors);
   }
   if (Symbols.noMainProperlyDeclared())
     Errors.noMainProperlyDeclared(ctx);
+  Scopes.pop_back();
   Symbols.popScope();
   Errors.print();
   DEBUG_EXIT();
@@ -48,19 +81,16 @@ antlrcpp::Any TypeCheckVisitor::visitProgram(AslParser::ProgramContext *ctx) {
 
 antlrcpp::Any TypeCheckVisitor::visitFunction(AslParser::FunctionContext *ctx) {
   DEBUG_ENTER();
-  TypesMgr::TypeId t = Types.createVoidTy();
-  vector<TypesMgr::TypeId> paramTy;
+  ReturnTy = Types.createVoidTy();
   if(ctx->basic_type()){
-    t = getTypeDecor(ctx->basic_type());
+    ReturnTy = getTypeDecor(ctx->basic_type());
   }
-  TypesMgr::TypeId t_func = Types.createFunctionTy(paramTy, t);
-  Symbols.setCurrentFunctionTy(t_func);
   
   SymTable::ScopeId sc = getScopeDecor(ctx);
-  Symbols.pushThisScope(sc);
+  Scopes.push_back(sc);
   // Symbols.print();
   visit(ctx->statements());
-  Symbols.popScope();
+  Scopes.pop_back();
   DEBUG_EXIT();
   return 0;
 }
@@ -172,15 +202,14 @@ antlrcpp::Any TypeCheckVisitor::visitWriteExpr(AslParser::WriteExprContext *ctx)
 
 antlrcpp::Any TypeCheckVisitor::visitReturnStmt(AslParser::ReturnStmtContext *ctx) {
   DEBUG_ENTER();
-  TypesMgr::TypeId t_func = Symbols.getCurrentFunctionTy();
+  TypesMgr::TypeId t_ret = ReturnTy;
   
   if (ctx->expr()) {
     visit(ctx->expr());
     TypesMgr::TypeId t = getTypeDecor(ctx->expr());
-    TypesMgr::TypeId t_ret = Types.getFuncReturnType(t_func);
     
     //void function trying to return something
-    if (Types.isErrorTy(t) and (not Types.isVoidFunction(t_func))) {
+    if (Types.isErrorTy(t) and (not Types.isVoidTy(t_ret))) {
       Errors.incompatibleReturn(ctx->RETURN());
     }
     //function trying to return something wrong
@@ -190,7 +219,7 @@ antlrcpp::Any TypeCheckVisitor::visitReturnStmt(AslParser::ReturnStmtContext *ct
       }      
     }
   }
-  else if (not Types.isVoidFunction(t_func)) {
+  else if (not Types.isVoidTy(t_ret)) {
     Errors.incompatibleReturn(ctx->RETURN());
   }
   
@@ -204,6 +233,7 @@ antlrcpp::Any TypeCheckVisitor::visitParenthesis(AslParser::ParenthesisContext *
   visit(ctx->expr());
   TypesMgr::TypeId t = getTypeDecor(ctx->expr());
   putTypeDecor(ctx, t);
+  putSymbolDecor(ctx, getSymbolDecor(ctx->expr()));
   DEBUG_EXIT();
   return 0;
 }
@@ -234,6 +264,9 @@ antlrcpp::Any TypeCheckVisitor::visitLeft_expr(AslParser::Left_exprContext *ctx)
       t_id = Types.getArrayElemType(t_id);
     }
   }
+  else {  // just an identifier
+    putSymbolDecor(ctx, getSymbolDecor(ctx->ident()));
+  }
   
   putTypeDecor(ctx, t_id);
   putIsLValueDecor(ctx, isL);
@@ -425,6 +458,7 @@ antlrcpp::Any TypeCheckVisitor::visitExprIdent(AslParser::ExprIdentContext *ctx)
   putTypeDecor(ctx, t1);
   bool b = getIsLValueDecor(ctx->ident());
   putIsLValueDecor(ctx, b);
+  putSymbolDecor(ctx, getSymbolDecor(ctx->ident()));
   DEBUG_EXIT();
   return 0;
 }
@@ -432,16 +466,19 @@ antlrcpp::Any TypeCheckVisitor::visitExprIdent(AslParser::ExprIdentContext *ctx)
 antlrcpp::Any TypeCheckVisitor::visitIdent(AslParser::IdentContext *ctx) {
   DEBUG_ENTER();
   string ident = ctx->getText();
-  if (Symbols.findInStack(ident) == -1) {
+  // resolve the identifier once; later uses go through its SymbolId
+  SymTable::SymbolId sym = Symbols.resolve(ident, Scopes);
+  putSymbolDecor(ctx, sym);
+  if (not sym.found()) {
     Errors.undeclaredIdent(ctx->ID());
     TypesMgr::TypeId te = Types.createErrorTy();
     putTypeDecor(ctx, te);
     putIsLValueDecor(ctx, true);
   }
   else {
-    TypesMgr::TypeId t1 = Symbols.getType(ident);
+    TypesMgr::TypeId t1 = Symbols.getType(sym);
     putTypeDecor(ctx, t1);
-    if (Symbols.isFunctionClass(ident))
+    if (Symbols.isFunctionClass(sym))
       putIsLValueDecor(ctx, false);
     else
       putIsLValueDecor(ctx, true);
@@ -462,6 +499,9 @@ TypesMgr::TypeId TypeCheckVisitor::getTypeDecor(antlr4::ParserRuleContext *ctx)
 bool TypeCheckVisitor::getIsLValueDecor(antlr4::ParserRuleContext *ctx) {
   return Decorations.getIsLValue(ctx);
 }
+SymTable::SymbolId TypeCheckVisitor::getSymbolDecor(antlr4::ParserRuleContext *ctx) {
+  return Decorations.getSymbol(ctx);
+}
 
 // Setters for the necessary tree node attributes:
 //   Scope, Type ans IsLValue
@@ -474,3 +514,6 @@ void TypeCheckVisitor::putTypeDecor(antlr4::ParserRuleContext *ctx, TypesMgr::Ty
 void TypeCheckVisitor::putIsLValueDecor(antlr4::ParserRuleContext *ctx, bool b) {
   Decorations.putIsLValue(ctx, b);
 }
+void TypeCheckVisitor::putSymbolDecor(antlr4::ParserRuleContext *ctx, SymTable::SymbolId sym) {
+  Decorations.putSymbol(ctx, sym);
+}
@@ -38,6 +38,8 @@
 #include "../common/TreeDecoration.h"
 #include "../common/SemErrors.h"
 
+#include <vector>
+
 // using namespace std;
 
 
@@ -49,6 +51,13 @@
 // program has been added to their respective scope. In this visit,
 // if some node/method does not have an associated task, it does not
 // have to be visited/called so no redefinition is needed.
+//
+// The visitor keeps its own stack of scopes and the return type of
+// the function being checked, and it does not create new types: the
+// body of a function only reads the symbols and types and decorates
+// its own nodes. So the functions can be checked in parallel, each
+// one by a visitor with its own SemErrors, whose errors are added
+// (in the order of the functions) to the ones of the program.
 
 class TypeCheckVisitor final : public AslBaseVisitor {
 
@@ -60,6 +69,15 @@ public:
 		   TreeDecoration & Decorations,
 		   SemErrors      & Errors);
 
+  // Set the number of threads used to check the functions (1 by
+  // default, 0 means one per processor)
+  void setNumberOfThreads(unsigned n);
+
+  // Set the functions (by their position in the program) that are not
+  // checked, because their code is reused from a previous compilation
+  // where they had no errors (see --incremental in main.cpp)
+  void setSkippedFunctions(const std::vector<bool> & skipped);
+
   // Methods to visit each kind of node:
   antlrcpp::Any visitProgram(AslParser::ProgramContext *ctx);
   antlrcpp::Any visitFunction(AslParser::FunctionContext *ctx);
@@ -92,17 +110,25 @@ private:
   SymTable       & Symbols;
   TreeDecoration & Decorations;
   SemErrors      & Errors;
+  unsigned         NumThreads = 1;
+  std::vector<bool> Skipped;
+
+  // Stack of scopes, and return type of the current function
+  std::vector<SymTable::ScopeId> Scopes;
+  TypesMgr::TypeId               ReturnTy;
 
   // Getters for the necessary tree node atributes:
   //   Scope, Type ans IsLValue
   SymTable::ScopeId getScopeDecor    (antlr4::ParserRuleContext *ctx);
   TypesMgr::TypeId  getTypeDecor     (antlr4::ParserRuleContext *ctx);
   bool              getIsLValueDecor (antlr4::ParserRuleContext *ctx);
+  SymTable::SymbolId getSymbolDecor  (antlr4::ParserRuleContext *ctx);
 
   // Setters for the necessary tree node attributes:
   //   Scope, Type ans IsLValue
   void putScopeDecor    (antlr4::ParserRuleContext *ctx, SymTable::ScopeId s);
   void putTypeDecor     (antlr4::ParserRuleContext *ctx, TypesMgr::TypeId t);
   void putIsLValueDecor (antlr4::ParserRuleContext *ctx, bool b);
+  void putSymbolDecor   (antlr4::ParserRuleContext *ctx, SymTable::SymbolId sym);
 
 };  // class TypeCheckVisitor
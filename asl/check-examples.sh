@@ -60,3 +60,151 @@ echo "END   examples-initial/execution"
 #     rm -f tmp.t tmp.out
 # done
 # echo "END   examples-full/execution"
+
+echo ""
+echo "BEGIN examples-full/execution (asl --run)"
+for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+    echo $(basename "$f")
+    ./asl --run "$f" < "${f/asl/in}" > tmp.out
+    diff tmp.out "${f/asl/out}"
+    rm -f tmp.out
+done
+echo "END   examples-full/execution (asl --run)"
+
+echo ""
+echo "BEGIN examples-full/binary t-code (asl --emit-binary, --convert)"
+for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+    echo $(basename "$f")
+    ./asl --emit-binary tmp.bin "$f"
+    ./asl --run tmp.bin < "${f/asl/in}" > tmp.out
+    diff tmp.out "${f/asl/out}"
+    ./asl "$f" > tmp.t
+    ./asl --convert tmp.bin tmp2.t
+    diff -B tmp.t tmp2.t
+    rm -f tmp.bin tmp.t tmp2.t tmp.out
+done
+echo "END   examples-full/binary t-code (asl --emit-binary, --convert)"
+
+echo ""
+echo "BEGIN examples-full/batch compilation (asl --jobs)"
+rm -rf tmp.jobs; mkdir tmp.jobs
+cp ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl tmp.jobs/
+./asl --jobs 4 tmp.jobs/*.asl
+for f in tmp.jobs/*.asl; do
+    echo $(basename "$f")
+    ./asl "$f" > tmp.t
+    diff tmp.t "${f/.asl/.t}"
+    rm -f tmp.t
+done
+rm -rf tmp.jobs
+echo "END   examples-full/batch compilation (asl --jobs)"
+
+echo ""
+echo "BEGIN examples-full/parallel typecheck and codegen (asl --threads)"
+for f in ../examples/*.asl; do
+    echo $(basename "$f")
+    ./asl "$f" > tmp.t
+    ./asl --threads 4 "$f" > tmp2.t
+    diff tmp.t tmp2.t
+    rm -f tmp.t tmp2.t
+done
+echo "END   examples-full/parallel typecheck and codegen (asl --threads)"
+
+echo ""
+echo "BEGIN examples-full/compiler server (asl --server, aslc)"
+# (the client has to be built first: make -C ../aslc)
+export ASL_SOCKET=$(mktemp -u /tmp/asl-check.XXXXXX)
+./asl --server "$ASL_SOCKET" 2> /dev/null &
+server=$!
+for i in $(seq 100); do [ -S "$ASL_SOCKET" ] && break; sleep 0.1; done
+# without a server aslc would run asl instead: ASL=false makes it fail
+for f in ../examples/*.asl; do
+    echo $(basename "$f")
+    ./asl "$f" > tmp.t 2> tmp.err; status=$?
+    ASL=false ../aslc/aslc "$f" > tmp2.t 2> tmp2.err; status2=$?
+    diff tmp.t tmp2.t
+    diff tmp.err tmp2.err
+    [ $status = $status2 ] || echo "exit status $status2 instead of $status"
+    ./asl -O2 "$f" > tmp.t 2> tmp.err
+    ASL=false ../aslc/aslc -O2 "$f" > tmp2.t 2> tmp2.err
+    diff tmp.t tmp2.t
+    diff tmp.err tmp2.err
+    rm -f tmp.t tmp2.t tmp.err tmp2.err
+done
+../aslc/aslc --shutdown
+wait $server
+[ -e "$ASL_SOCKET" ] && echo "the server did not remove $ASL_SOCKET"
+unset ASL_SOCKET
+echo "END   examples-full/compiler server (asl --server, aslc)"
+
+echo ""
+echo "BEGIN examples-full/compile cache (asl --cache-dir)"
+rm -rf tmp.cache
+for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+    echo $(basename "$f")
+    ./asl "$f" > tmp.t
+    ./asl --cache-dir tmp.cache "$f" > tmp2.t
+    ./asl --cache-dir tmp.cache "$f" > tmp3.t
+    diff tmp.t tmp2.t
+    diff tmp.t tmp3.t
+    ./asl --cache-dir tmp.cache --run "$f" < "${f/asl/in}" > tmp.out
+    diff tmp.out "${f/asl/out}"
+    rm -f tmp.t tmp2.t tmp3.t tmp.out
+done
+rm -rf tmp.cache
+echo "END   examples-full/compile cache (asl --cache-dir)"
+
+echo ""
+echo "BEGIN examples-full/incremental compilation (asl --incremental)"
+rm -rf tmp.cache
+for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+    echo $(basename "$f")
+    ./asl "$f" > tmp.t
+    ./asl --cache-dir tmp.cache --incremental "$f" > /dev/null
+    # another program with the same functions: all of them are reused
+    (cat "$f"; echo "// edited") > tmp.asl
+    ./asl --cache-dir tmp.cache --incremental tmp.asl > tmp2.t
+    diff tmp.t tmp2.t
+    rm -f tmp.t tmp2.t tmp.asl
+done
+rm -rf tmp.cache
+echo "END   examples-full/incremental compilation (asl --incremental)"
+
+echo ""
+echo "BEGIN examples-full/incremental recompilation of changed functions"
+# each edit of jp_genc_04 (f1, called by main) is compiled with the
+# cache of the original program: the code must be the one of a clean
+# compile, and only the given number of functions can be reused
+f=../examples/jp_genc_04.asl
+while read -r name reused edit; do
+    echo "$(basename "$f") ($name)"
+    rm -rf tmp.cache
+    ./asl --cache-dir tmp.cache --incremental "$f" > /dev/null
+    sed "$edit" "$f" > tmp.asl
+    ./asl tmp.asl > tmp.t; status=$?
+    ./asl --cache-dir tmp.cache --incremental --stats=json tmp.asl > tmp2.t 2> tmp.stats; status2=$?
+    diff tmp.t tmp2.t
+    [ $status = $status2 ] || echo "exit status $status2 instead of $status"
+    grep -q "\"functions-reused\": $reused[,}]" tmp.stats ||
+        echo "$reused functions should be reused: $(grep -o '"functions-reused": [0-9]*' tmp.stats)"
+    rm -f tmp.asl tmp.t tmp2.t tmp.stats
+done <<'EDITS'
+body      1 s/c = 2\*c + 1;/c = 2*c + 2;/
+signature 0 s/func f1(a: int, b:int)/func f1(a: float, b:int)/
+deletion  0 /^func f1/,/^endfunc/d
+EDITS
+rm -rf tmp.cache
+echo "END   examples-full/incremental recompilation of changed functions"
+
+echo ""
+echo "BEGIN examples-full/optimized code (asl -O1, -O2)"
+for level in -O1 -O2; do
+    for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+        echo $level $(basename "$f")
+        ./asl $level "$f" > tmp.t
+        ./asl --run tmp.t < "${f/asl/in}" > tmp.out
+        diff tmp.out "${f/asl/out}"
+        rm -f tmp.t tmp.out
+    done
+done
+echo "END   examples-full/optimized code (asl -O1, -O2)"
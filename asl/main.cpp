@@ -41,55 +41,268 @@
 #include "SymbolsVisitor.h"
 #include "TypeCheckVisitor.h"
 #include "../common/code.h"
+#include "../common/interpreter.h"
+#include "../common/codeio.h"
+#include "../common/PhaseStats.h"
+#include "../common/WorkPool.h"
+#include "../common/aslsocket.h"
+#include "../common/SourceInput.h"
+#include "../common/CompileCache.h"
+#include "../common/codeopt.h"
 #include "CodeGenVisitor.h"
 
 #include <iostream>
-#include <fstream>    // ifstream
+#include <fstream>    // ofstream
+#include <sstream>    // ostringstream
+#include <functional>
+#include <memory>
+#include <vector>
+#include <algorithm>  // sort
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
 
-#include <cstdio>     // fopen
+#include <cstdio>     // remove
 #include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS
+#include <cstring>    // strcmp
+#include <string>
+
+#include <cerrno>
+
+#include <sys/stat.h> // stat
+#include <sys/socket.h>
+#include <unistd.h>   // close, unlink
 
 // using namespace std;
 // using namespace antlr4;
 
 
-int main(int argc, const char* argv[]) {
-  // check the correct use of the program
-  if (argc > 2) {
-    std::cout << "Usage: ./main [<file>]" << std::endl;
+// execute a code in memory, reading from std::cin
+static int runCode(const code & c) {
+  interpreter vm(c);
+  if (not vm.run(std::cin, std::cout)) {
+    std::cerr << "Runtime error: " << vm.getError() << std::endl;
     return EXIT_FAILURE;
   }
-  if (argc == 2 and not std::fopen(argv[1], "r")) {
-    std::cout << "No such file: " << argv[1] << std::endl;
-    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
+
+// load already generated t-code from a mapped file: binary
+// (recognized by its magic number) or text (.t files)
+static bool loadCode(const MappedFile & file, const std::string & path, code & c) {
+  if (bincodeReader::is_bincode(file.getData(), file.getSize())) {
+    bincodeReader reader;
+    if (not reader.open(file.getData(), file.getSize(), path)) {
+      std::cerr << reader.get_error() << std::endl;
+      return false;
+    }
+    c = reader.to_code();
+    return true;
+  }
+  std::string error;
+  if (not parse_code(file.getData(), file.getSize(), c, error)) {
+    std::cerr << path << ", " << error << std::endl;
+    return false;
   }
+  return true;
+}
+
+// true if the mapped file holds t-code instead of an Asl program
+static bool isCodeFile(const MappedFile & file, const std::string & path) {
+  return bincodeReader::is_bincode(file.getData(), file.getSize()) or
+    (path.size() > 2 and path.compare(path.size()-2, 2, ".t") == 0);
+}
 
-  // open input file (or std::cin) and create a character stream
-  antlr4::ANTLRInputStream input;
-  if (argc == 2) {  // read from <file>
-    std::ifstream stream;
-    stream.open(argv[1]);
-    input = antlr4::ANTLRInputStream(stream);
+// write a code in binary format
+static bool writeBinary(const code & c, const std::string & path) {
+  std::ofstream out(path, std::ios::binary);
+  if (not out or not bincodeWriter::write(c, out)) {
+    std::cerr << "Can not write " << path << std::endl;
+    return false;
   }
-  else {            // read fron std::cin
-    input = antlr4::ANTLRInputStream(std::cin);
+  return true;
+}
+
+
+// antlr writes the syntax errors on std::cerr: this listener writes
+// them (in the same format) on any other stream
+class StreamErrorListener : public antlr4::BaseErrorListener {
+public:
+  StreamErrorListener(std::ostream & os) : os(os) {}
+  void syntaxError(antlr4::Recognizer *recognizer, antlr4::Token *offendingSymbol,
+                   std::size_t line, std::size_t charPositionInLine,
+                   const std::string & msg, std::exception_ptr e) override {
+    os << "line " << line << ":" << charPositionInLine << " " << msg << std::endl;
+  }
+private:
+  std::ostream & os;
+};
+
+
+// statistics of the two-stage parsing of one or more programs
+// (--parse-stats). Programs compiled by different threads may add
+// their numbers at the same time
+class ParseStats {
+public:
+  void add(double sllMs, double llMs, bool fallback) {
+    std::lock_guard<std::mutex> guard(lock);
+    ++programs;
+    if (fallback) ++fallbacks;
+    totalSllMs += sllMs;
+    totalLlMs += llMs;
+  }
+  void print(std::ostream & os, bool llOnly) {
+    std::lock_guard<std::mutex> guard(lock);
+    char line[160];
+    std::snprintf(line, sizeof(line),
+                  "parse (%s): %zu programs, %zu parsed again with LL (%.1f%%), "
+                  "SLL stage %.3f ms, LL stage %.3f ms\n",
+                  llOnly ? "LL only" : "SLL first", programs, fallbacks,
+                  programs ? 100.0 * fallbacks / programs : 0.0, totalSllMs, totalLlMs);
+    os << line;
+  }
+private:
+  std::mutex  lock;
+  std::size_t programs = 0, fallbacks = 0;
+  double      totalSllMs = 0, totalLlMs = 0;
+};
+
+// options of the compilation of a program
+struct CompileOptions {
+  // threads used to check and generate the functions (--threads)
+  unsigned     threads = 1;
+  // parse directly with full LL prediction (--parse-ll)
+  bool         parseLL = false;
+  // where the parsing stages are accounted (--parse-stats), or null
+  ParseStats * parseStats = nullptr;
+  // where the generated code is kept (--cache-dir), or null
+  CompileCache * cache = nullptr;
+  // reuse the code of the unchanged functions from the cache
+  // (--incremental)
+  bool           incremental = false;
+  // optimization level of the generated code (-O0, -O1, -O2)
+  unsigned       optimize = 0;
+};
+
+// the key in the cache of the code of a program written in 'format'
+// ("text" or "binary") with the options 'opts'
+static std::string cacheKey(const char *data, std::size_t size, const CompileOptions & opts,
+                            const std::string & format) {
+  // the other options do not change the generated code
+  return opts.cache->getKey(data, size, format + " -O" + std::to_string(opts.optimize));
+}
+
+// the key in the cache of the code of the function 'func' (with
+// --incremental): its tokens, and the signatures in the global scope
+// of the functions it may call (its own included), that are all its
+// type check and code generation depend on
+static std::string functionKey(AslParser::FunctionContext *func,
+                               antlr4::CommonTokenStream & tokens,
+                               const TypesMgr & types, const SymTable & symbols,
+                               SymTable::ScopeId global, const CompileOptions & opts) {
+  std::string text, callees;
+  std::set<std::string> seen;
+  const std::vector<SymTable::ScopeId> scopes(1, global);
+  for (std::size_t i = func->getStart()->getTokenIndex();
+       i <= func->getStop()->getTokenIndex(); ++i) {
+    std::string token = tokens.get(i)->getText();
+    text += token;
+    text += ' ';
+    if (not seen.insert(token).second) continue;
+    SymTable::SymbolId sym = symbols.resolve(token, scopes);
+    if (sym.found() and symbols.isFunctionClass(sym))
+      callees += token + ": " + types.to_string(symbols.getType(sym)) + "\n";
   }
+  text += '\0';
+  text += callees;
+  return cacheKey(text.data(), text.size(), opts, "function");
+}
+
+// milliseconds elapsed since 'start'
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// compile the Asl program in the 'size' bytes of 'data', giving every generated
+// subroutine to 'sink'. The messages are written on 'msgs' (syntax
+// errors on 'errs') and each phase is measured in 'stats', where the
+// "codegen" phase is left running (the sink may have work to finish).
+// All the objects used live in this call, so several programs can be
+// compiled at the same time from different threads. Besides, the
+// functions of the program can be checked and generated with
+// several threads (see CompileOptions).
+// Returns false if the program has errors
+static bool compile(const char *data, std::size_t size, std::ostream & msgs, std::ostream & errs,
+                    PhaseStats & stats, const CompileOptions & opts,
+                    const std::function<void(subroutine &&)> & sink) {
+  // create a character stream from the input: an ASCII program is
+  // read in place, any other is decoded (UTF-8) into a copy
+  std::unique_ptr<antlr4::CharStream> input;
+  if (ByteCharStream::isAscii(data, size))
+    input.reset(new ByteCharStream(data, size));
+  else
+    input.reset(new antlr4::ANTLRInputStream(data, size));
 
   // create a lexer that consumes the character stream and produces a token stream
-  AslLexer lexer(&input);
+  stats.startPhase("lex");
+  StreamErrorListener errorListener(errs);
+  AslLexer lexer(input.get());
+  lexer.removeErrorListeners();
+  lexer.addErrorListener(&errorListener);
   antlr4::CommonTokenStream tokens(&lexer);
+  tokens.fill();
+  stats.setCounter("tokens", tokens.size());
 
-  // create a parser that consumes the token stream, and parses it.
+  // create a parser that consumes the token stream, and parses it in
+  // two stages: first with SLL prediction (much faster on the
+  // expressions) bailing out at the first error, and only if it fails
+  // again with full LL prediction, that reports the syntax errors.
+  // SLL may fail on a correct program, but when it succeeds the tree
+  // is the same that LL would build
+  stats.startPhase("parse");
   AslParser parser(&tokens);
-
-  // call the parser and get the parse tree
-  antlr4::tree::ParseTree *tree = parser.program();
+  parser.removeErrorListeners();
+  auto *interpreter = parser.getInterpreter<antlr4::atn::ParserATNSimulator>();
+  antlr4::tree::ParseTree *tree = nullptr;
+  auto start = std::chrono::steady_clock::now();
+  double sllMs = 0;
+  if (not opts.parseLL) {
+    interpreter->setPredictionMode(antlr4::atn::PredictionMode::SLL);
+    parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+    try {
+      tree = parser.program();
+    }
+    catch (antlr4::ParseCancellationException &) {
+      tree = nullptr;
+    }
+    sllMs = elapsedMs(start);
+  }
+  bool fallback = not tree and not opts.parseLL;
+  if (not tree) {
+    if (fallback) {
+      stats.startPhase("parse-ll");
+      start = std::chrono::steady_clock::now();
+      tokens.reset();
+      parser.reset();
+    }
+    interpreter->setPredictionMode(antlr4::atn::PredictionMode::LL);
+    parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+    parser.addErrorListener(&errorListener);
+    tree = parser.program();
+  }
+  if (opts.parseStats)
+    opts.parseStats->add(sllMs, fallback or opts.parseLL ? elapsedMs(start) : 0, fallback);
 
   // check for lexical or syntactical errors
   if (lexer.getNumberOfSyntaxErrors() > 0 or
       parser.getNumberOfSyntaxErrors() > 0) {
-    std::cout << "Lexical and/or syntactical errors have been found." << std::endl;
-    return EXIT_FAILURE;
+    msgs << "Lexical and/or syntactical errors have been found." << std::endl;
+    stats.endPhase();
+    return false;
   }
 
   // print the parse tree (for debugging purposes)
@@ -100,30 +313,627 @@ int main(int argc, const char* argv[]) {
   TypesMgr       types;
   SymTable       symbols(types);
   TreeDecoration decorations;
-  SemErrors      errors;
+  SemErrors      errors(msgs);
+
+  // number the nodes of the tree, so that the decorations can be
+  // stored in arrays indexed by node
+  stats.startPhase("index");
+  decorations.indexTree(tree);
+  stats.setCounter("nodes", decorations.getNumberOfNodes());
 
   // create a visitor that looks for variables and function declarations
   // in the tree and stores required information
+  stats.startPhase("symbols");
   SymbolsVisitor symboldecl(types, symbols, decorations, errors);
   symboldecl.visit(tree);
 
+  // incremental compilation: the functions whose key (see
+  // functionKey) is in the cache reuse the code generated for them
+  // in a previous compilation, so they are neither checked (they had
+  // no errors) nor generated again
+  auto *program = static_cast<AslParser::ProgramContext *>(tree);
+  std::vector<std::string> funcKeys;
+  std::vector<bool> funcReused;
+  std::vector<std::unique_ptr<subroutine>> reused;
+  if (opts.incremental) {
+    stats.startPhase("reuse");
+    SymTable::ScopeId global = decorations.getScope(program);
+    std::size_t count = 0;
+    for (auto func : program->function()) {
+      funcKeys.push_back(functionKey(func, tokens, types, symbols, global, opts));
+      std::unique_ptr<subroutine> subr;
+      std::string text, error;
+      if (opts.cache->fetch(funcKeys.back(), text)) {
+        std::istringstream is(text);
+        code c;
+        if (parse_code(is, c, error) and c.get_subroutines().size() == 1)
+          subr.reset(new subroutine(std::move(c.get_last_subroutine())));
+      }
+      if (subr) ++count;
+      funcReused.push_back(bool(subr));
+      reused.push_back(std::move(subr));
+    }
+    stats.setCounter("functions", funcKeys.size());
+    stats.setCounter("functions-reused", count);
+  }
+
   // create another visitor that will perform type checkings wherever
   // it is needed (on expressions, assignments, parameter passing, etc)
+  stats.startPhase("typecheck");
   TypeCheckVisitor typecheck(types, symbols, decorations, errors);
+  typecheck.setNumberOfThreads(opts.threads);
+  typecheck.setSkippedFunctions(funcReused);
   typecheck.visit(tree);
+  stats.endPhase();
+  stats.setCounter("types", types.getNumberOfTypes());
+  stats.setCounter("scopes", symbols.getNumberOfScopes());
+  stats.setCounter("symbols", symbols.getNumberOfSymbols());
 
   if (errors.getNumberOfSemanticErrors() > 0) {
-    std::cout << "There are semantic errors: no code generated." << std::endl;
-    return EXIT_FAILURE;
+    msgs << "There are semantic errors: no code generated." << std::endl;
+    return false;
   }
 
-  // create a third visitor that will return the generated code
-  // for each part of the tree, and will store it in 'mycode'
+  // create a third visitor that generates the code of each
+  // subroutine and gives it to the sink
+  stats.startPhase("codegen");
   CodeGenVisitor codegenerator(types, symbols, decorations);
-  code mycode = codegenerator.visit(tree);
+  codegenerator.setNumberOfThreads(opts.threads);
+  codegenerator.setReusedSubroutines(&reused);
+  passManager optimizer(opts.optimize);
+  if (not optimizer.empty())
+    codegenerator.setSubroutinePass([&](subroutine & s) { optimizer.run(s); });
+  std::size_t subroutines = 0, instructions = 0;
+  codegenerator.setSubroutineSink([&](subroutine && s) {
+      // the subroutines come in the order of the functions: the new
+      // ones are added to the cache
+      if (subroutines < funcKeys.size() and not funcReused[subroutines]) {
+        CompileCache::Entry entry(*opts.cache, funcKeys[subroutines]);
+        s.dump(entry.stream());
+        entry.commit();
+      }
+      ++subroutines;
+      instructions += s.get_instructions().size();
+      sink(std::move(s));
+    });
+  codegenerator.visit(tree);
+  for (auto & p : optimizer.get_stats())
+    stats.addPass(p.name, p.ms, p.runs, p.changes);
+  stats.setCounter("subroutines", subroutines);
+  stats.setCounter("instructions", instructions);
+  return true;
+}
+
+
+// name of the file with the t-code of an Asl program (foo.asl -> foo.t)
+static std::string codeFileName(const std::string & path) {
+  std::string base = path;
+  if (base.size() > 4 and base.compare(base.size()-4, 4, ".asl") == 0)
+    base.resize(base.size()-4);
+  return base + ".t";
+}
+
+// compile the Asl program in 'path' into its t-code file (which is
+// removed if the program has errors)
+static bool compileFile(const std::string & path, const CompileOptions & opts,
+                        std::ostream & msgs) {
+  // the operands of each file have a pool of their own
+  operandPool::scope names(std::make_shared<operandPool>());
+  MappedFile in;
+  if (not in.open(path)) {
+    if (in.notFound()) msgs << "No such file: " << path << std::endl;
+    else               msgs << in.getError() << std::endl;
+    return false;
+  }
+  std::string outPath = codeFileName(path);
+  std::ofstream out;
+  std::string key, cached;
+  std::unique_ptr<CompileCache::Entry> entry;
+  if (opts.cache) {
+    key = cacheKey(in.getData(), in.getSize(), opts, "text");
+    if (opts.cache->fetch(key, cached)) {
+      out.open(outPath);
+      out << cached;
+      out.close();
+      if (out) return true;
+      msgs << "Can not write " << outPath << std::endl;
+      std::remove(outPath.c_str());
+      return false;
+    }
+    entry.reset(new CompileCache::Entry(*opts.cache, key));
+  }
+  PhaseStats stats;
+  bool ok = compile(in.getData(), in.getSize(), msgs, msgs, stats, opts, [&](subroutine && s) {
+      if (not out.is_open()) out.open(outPath);
+      s.dump(out);
+      if (entry) s.dump(entry->stream());
+    });
+  if (ok) {
+    out << std::endl;
+    out.close();
+    if (not out) {
+      msgs << "Can not write " << outPath << std::endl;
+      ok = false;
+    }
+  }
+  if (not ok) std::remove(outPath.c_str());
+  else if (entry) {
+    entry->stream() << std::endl;
+    entry->commit();
+  }
+  return ok;
+}
+
+// compile several Asl programs at the same time with 'jobs' threads
+// (--jobs). The biggest files are started first, and the messages of
+// each program are printed together, every line preceded by its file
+// name. Returns the exit status
+static int compileBatch(const std::vector<std::string> & files, unsigned jobs,
+                        const CompileOptions & opts, PhaseStats & stats) {
+  std::vector<std::pair<off_t, std::size_t>> order;
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    struct stat st;
+    off_t size = stat(files[i].c_str(), &st) == 0 ? st.st_size : 0;
+    order.push_back(std::make_pair(-size, i));
+  }
+  std::sort(order.begin(), order.end());
+
+  stats.startPhase("compile");
+  WorkPool pool(jobs);
+  std::mutex outputLock;
+  std::atomic<std::size_t> failed(0);
+  pool.run(order.size(), [&](std::size_t k) {
+      const std::string & path = files[order[k].second];
+      std::ostringstream msgs;
+      if (not compileFile(path, opts, msgs)) ++failed;
+      std::istringstream lines(msgs.str());
+      std::ostringstream text;
+      std::string line;
+      while (std::getline(lines, line)) text << path << ": " << line << "\n";
+      std::lock_guard<std::mutex> guard(outputLock);
+      std::cout << text.str() << std::flush;
+    });
+  stats.endPhase();
+  stats.setCounter("files", files.size());
+  stats.setCounter("failed", failed);
+  stats.setCounter("threads", pool.getNumberOfThreads());
+  return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 
-  // print generated code as output
-  std::cout << mycode.dump() << std::endl;
+// a small program with every construct of the language. The server
+// compiles it when it starts, so that the caches of the lexer and the
+// parser (shared by all their instances) are warm for the first request
+static const char *WarmUpProgram =
+  "func f(a: int, x: float, v: array [4] of int): float\n"
+  "  var i: int\n"
+  "  var c: char\n"
+  "  var b: bool\n"
+  "  i = 0;\n"
+  "  c = 'a';\n"
+  "  b = not (a < 3) or a >= 2 and a != 1;\n"
+  "  while i < 4 do\n"
+  "    if b == true then v[i] = -(a * i + 1) / 2 % 3;\n"
+  "    else read v[i]; endif\n"
+  "    i = i + 1;\n"
+  "  endwhile\n"
+  "  write \"ok\\n\";\n"
+  "  write c;\n"
+  "  return (x - 1.5) * a + v[0];\n"
+  "endfunc\n"
+  "func main()\n"
+  "  var v: array [4] of int\n"
+  "  var y: float\n"
+  "  y = f(1, 2.0, v);\n"
+  "  f(2, y, v);\n"
+  "  write y;\n"
+  "endfunc\n";
 
+// answer a compile request of the server: the same that asl writes
+// on std::cout and std::cerr when run with 'options' on 'source'
+static int serveCompile(const std::vector<std::string> & options, const std::string & source,
+                        std::ostream & output, std::ostream & errors) {
+  // the operands of each request have a pool of their own, freed
+  // when it has been answered
+  operandPool::scope names(std::make_shared<operandPool>());
+  CompileOptions opts;
+  ParseStats parseStats;
+  bool timeReport = false, jsonStats = false;
+  for (std::size_t i = 0; i < options.size(); ++i) {
+    if (options[i] == "--threads" and i+1 < options.size())
+      opts.threads = std::strtoul(options[++i].c_str(), nullptr, 10);
+    else if (options[i] == "-O0" or options[i] == "-O1" or options[i] == "-O2")
+      opts.optimize = options[i][2] - '0';
+    else if (options[i] == "--parse-ll")    opts.parseLL = true;
+    else if (options[i] == "--parse-stats") opts.parseStats = &parseStats;
+    else if (options[i] == "--time-report") timeReport = true;
+    else if (options[i] == "--stats=json")  jsonStats = true;
+    else {
+      errors << "Option not supported by the server: " << options[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  PhaseStats stats;
+  stats.startPhase("read");
+  bool ok = compile(source.data(), source.size(), output, errors, stats, opts, [&](subroutine && s) {
+      s.dump(output);
+    });
+  if (ok) output << std::endl;
+  stats.endPhase();
+  if (timeReport)       stats.printReport(errors);
+  if (jsonStats)        stats.printJSON(errors);
+  if (opts.parseStats)  parseStats.print(errors, opts.parseLL);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// compiler server (--server): answers the requests of the clients
+// (see aslsocket.h) on the Unix socket 'path', each one in a thread
+// of its own, until one of them asks it to shut down
+static int serve(const std::string & path) {
+  std::string error;
+  int listenFd = listen_unix(path, error);
+  if (listenFd < 0) {
+    std::cerr << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  {
+    std::ostringstream ignored;
+    serveCompile({}, WarmUpProgram, ignored, ignored);
+  }
+  std::cerr << "asl server listening on " << path << std::endl;
+
+  std::mutex lock;
+  std::condition_variable idle;
+  unsigned active = 0;
+  std::atomic<bool> stop(false);
+  while (not stop) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR or errno == ECONNABORTED) continue;
+      if (not stop) std::cerr << "accept: " << std::strerror(errno) << std::endl;
+      break;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    ++active;
+    std::thread([&, fd] {
+        std::string command, options, source;
+        if (read_frame(fd, command) and read_frame(fd, options) and read_frame(fd, source)) {
+          std::ostringstream output, errors;
+          int status = EXIT_SUCCESS;
+          if (command == "compile")
+            status = serveCompile(split_options(options), source, output, errors);
+          else if (command == "shutdown") {
+            stop = true;
+            shutdown(listenFd, SHUT_RDWR);    // wakes up the accept
+          }
+          else {
+            errors << "Unknown request: " << command << std::endl;
+            status = EXIT_FAILURE;
+          }
+          write_frame(fd, std::to_string(status)) and
+            write_frame(fd, output.str()) and write_frame(fd, errors.str());
+        }
+        close(fd);
+        std::lock_guard<std::mutex> guard(lock);
+        --active;
+        idle.notify_all();
+      }).detach();
+  }
+
+  // wait for the requests being answered
+  std::unique_lock<std::mutex> guard(lock);
+  idle.wait(guard, [&] { return active == 0; });
+  close(listenFd);
+  unlink(path.c_str());
   return EXIT_SUCCESS;
 }
+
+
+int main(int argc, const char* argv[]) {
+  // options:
+  //   --run executes the generated code (reading the program input
+  //         from std::cin) instead of printing it. The file may also
+  //         be t-code (text or binary)
+  //   --emit-binary <out> writes the generated code in binary format
+  //   --convert <in> <out> converts t-code between text and binary
+  //         (the direction is given by the format of <in>)
+  //   --time-report writes (on std::cerr) the time, allocations and
+  //         memory of each phase, and the size of the program
+  //   --stats=json writes the same information as a JSON object
+  //   --jobs <n> <file>... compiles several programs at the same time
+  //         with n threads (0: one per processor). The code of each
+  //         foo.asl is written in foo.t
+  //   --threads <n> type checks and generates the code of the functions
+  //         of the program with n threads (0: one per processor)
+  //   -O1 optimizes the generated code: constant folding and
+  //         propagation, fusion of negated comparisons, copy
+  //         propagation, removal of dead code and renaming of the
+  //         temporals (-O0, the default, does not). -O2 also removes
+  //         the unreachable code and the stores to dead variables. The
+  //         time of each pass is in the --time-report
+  //   --parse-ll parses with full LL prediction only, instead of
+  //         trying SLL first
+  //   --parse-stats writes (on std::cerr) how many programs had to
+  //         be parsed again with LL, and the time of each stage
+  //   --server [<socket>] stays running as a compiler server that
+  //         answers the requests of the client aslc (see ../aslc)
+  //   --cache-dir <dir> keeps the generated code in <dir>, and gives
+  //         it without compiling when the same program (with the same
+  //         compiler and options) is compiled again
+  //   --cache-size <MB> limits the size of the cache (256 MB by
+  //         default): the least recently used entries are removed
+  //   --cache-stats writes (on std::cerr) the hits and misses of the
+  //         cache, and its size
+  //   --incremental (with --cache-dir) also keeps the code of each
+  //         function, that is reused (without checking nor generating
+  //         it) while neither the function nor the signatures of the
+  //         functions it calls change
+  bool run = false, timeReport = false, jsonStats = false;
+  bool batch = false, parseReport = false, cacheReport = false;
+  std::string cacheDir;
+  std::size_t cacheMB = 256;
+  unsigned jobs = 0;
+  CompileOptions opts;
+  ParseStats parseStats;
+  std::string binaryOut;
+  bool badOption = false;
+  while (argc > 1 and argv[1][0] == '-' and not badOption) {
+    if (std::strcmp(argv[1], "--run") == 0) {
+      run = true;
+      --argc; ++argv;
+    }
+    else if (argc > 2 and std::strcmp(argv[1], "--emit-binary") == 0) {
+      binaryOut = argv[2];
+      argc -= 2; argv += 2;
+    }
+    else if (argc > 2 and std::strcmp(argv[1], "--jobs") == 0) {
+      char *end;
+      jobs = std::strtoul(argv[2], &end, 10);
+      badOption = *argv[2] == '\0' or *end != '\0';
+      batch = true;
+      argc -= 2; argv += 2;
+    }
+    else if (argc > 2 and std::strcmp(argv[1], "--threads") == 0) {
+      char *end;
+      opts.threads = std::strtoul(argv[2], &end, 10);
+      badOption = *argv[2] == '\0' or *end != '\0';
+      argc -= 2; argv += 2;
+    }
+    else if (std::strcmp(argv[1], "-O0") == 0 or std::strcmp(argv[1], "-O1") == 0 or
+             std::strcmp(argv[1], "-O2") == 0) {
+      opts.optimize = argv[1][2] - '0';
+      --argc; ++argv;
+    }
+    else if (std::strcmp(argv[1], "--parse-ll") == 0) {
+      opts.parseLL = true;
+      --argc; ++argv;
+    }
+    else if (std::strcmp(argv[1], "--parse-stats") == 0) {
+      parseReport = true;
+      opts.parseStats = &parseStats;
+      --argc; ++argv;
+    }
+    else if (argc > 2 and std::strcmp(argv[1], "--cache-dir") == 0) {
+      cacheDir = argv[2];
+      argc -= 2; argv += 2;
+    }
+    else if (argc > 2 and std::strcmp(argv[1], "--cache-size") == 0) {
+      char *end;
+      cacheMB = std::strtoul(argv[2], &end, 10);
+      badOption = *argv[2] == '\0' or *end != '\0';
+      argc -= 2; argv += 2;
+    }
+    else if (std::strcmp(argv[1], "--incremental") == 0) {
+      opts.incremental = true;
+      --argc; ++argv;
+    }
+    else if (std::strcmp(argv[1], "--cache-stats") == 0) {
+      cacheReport = true;
+      --argc; ++argv;
+    }
+    else if (std::strcmp(argv[1], "--time-report") == 0) {
+      timeReport = true;
+      --argc; ++argv;
+    }
+    else if (std::strcmp(argv[1], "--stats=json") == 0) {
+      jsonStats = true;
+      --argc; ++argv;
+    }
+    else if (argc <= 3 and std::strcmp(argv[1], "--server") == 0)
+      return serve(argc == 3 ? argv[2] : default_socket_path());
+    else if (argc == 4 and std::strcmp(argv[1], "--convert") == 0) {
+      MappedFile file;
+      if (not file.open(argv[2])) {
+        std::cerr << file.getError() << std::endl;
+        return EXIT_FAILURE;
+      }
+      code c;
+      if (not loadCode(file, argv[2], c)) return EXIT_FAILURE;
+      if (bincodeReader::is_bincode(file.getData(), file.getSize())) {
+        std::ofstream out(argv[3]);
+        c.dump(out);
+        if (not out) {
+          std::cerr << "Can not write " << argv[3] << std::endl;
+          return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+      }
+      return writeBinary(c, argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else badOption = true;
+  }
+  // check the correct use of the program
+  if (badOption or (argc > 2 and not batch) or (run and argc != 2) or
+      (run and not binaryOut.empty()) or
+      (batch and (argc < 2 or run or not binaryOut.empty())) or
+      ((cacheReport or opts.incremental) and cacheDir.empty())) {
+    std::cout << "Usage: ./main [--time-report] [--stats=json] [--threads <n>] [-O0|-O1|-O2]" << std::endl;
+    std::cout << "              [--parse-ll] [--parse-stats]" << std::endl;
+    std::cout << "              [--cache-dir <dir> [--cache-size <MB>] [--cache-stats]" << std::endl;
+    std::cout << "                                 [--incremental]] [<file>]" << std::endl;
+    std::cout << "       ./main --run <file>" << std::endl;
+    std::cout << "       ./main --emit-binary <out> [<file>]" << std::endl;
+    std::cout << "       ./main --convert <in> <out>" << std::endl;
+    std::cout << "       ./main --jobs <n> <file>..." << std::endl;
+    std::cout << "       ./main --server [<socket>]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<CompileCache> cache;
+  if (not cacheDir.empty()) {
+    cache.reset(new CompileCache(cacheDir, cacheMB << 20));
+    if (not cache->open()) {
+      std::cerr << cache->getError() << std::endl;
+      return EXIT_FAILURE;
+    }
+    opts.cache = cache.get();
+  }
+
+  // print the statistics requested with --time-report, --stats=json,
+  // --parse-stats and --cache-stats, and return the exit status
+  PhaseStats stats;
+  auto finish = [&](int status) {
+    if (cache) {
+      stats.setCounter("cache-hits", cache->getHits());
+      stats.setCounter("cache-misses", cache->getMisses());
+    }
+    if (timeReport)  stats.printReport(std::cerr);
+    if (jsonStats)   stats.printJSON(std::cerr);
+    if (parseReport) parseStats.print(std::cerr, opts.parseLL);
+    if (cacheReport) cache->printStats(std::cerr);
+    return status;
+  };
+
+  // compile several files
+  if (batch) {
+    std::vector<std::string> files(argv + 1, argv + argc);
+    return finish(compileBatch(files, jobs, opts, stats));
+  }
+
+  // map the input file in memory (it is opened only this time)
+  MappedFile file;
+  if (argc == 2 and not file.open(argv[1])) {
+    if (file.notFound()) std::cout << "No such file: " << argv[1] << std::endl;
+    else                 std::cerr << file.getError() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // run t-code directly
+  if (run and argc == 2 and isCodeFile(file, argv[1])) {
+    code c;
+    stats.startPhase("load");
+    if (not loadCode(file, argv[1], c)) return finish(EXIT_FAILURE);
+    stats.startPhase("execute");
+    int status = runCode(c);
+    stats.endPhase();
+    return finish(status);
+  }
+
+  // the program is in the mapped file, or it is read from std::cin
+  stats.startPhase("read");
+  std::string stdinText;
+  if (argc != 2) {
+    std::ostringstream text;
+    text << std::cin.rdbuf();
+    stdinText = text.str();
+  }
+  const char *source = argc == 2 ? file.getData() : stdinText.data();
+  std::size_t sourceSize = argc == 2 ? file.getSize() : stdinText.size();
+
+  // look for the generated code in the cache (in 'cached')
+  std::string key, cached;
+  bool hit = false;
+  if (opts.cache) {
+    stats.startPhase("cache");
+    key = cacheKey(source, sourceSize, opts, binaryOut.empty() ? "text" : "binary");
+    hit = opts.cache->fetch(key, cached);
+  }
+
+  // execute the generated code in memory
+  if (run) {
+    code mycode;
+    if (hit) {
+      std::istringstream text(cached);
+      std::string error;
+      if (not parse_code(text, mycode, error)) {
+        std::cerr << "cache entry " << key << ", " << error << std::endl;
+        return finish(EXIT_FAILURE);
+      }
+    }
+    else {
+      if (not compile(source, sourceSize, std::cout, std::cerr, stats, opts, [&](subroutine && s) {
+            mycode.add_subroutine(std::move(s));
+          }))
+        return finish(EXIT_FAILURE);
+      if (opts.cache) {
+        CompileCache::Entry entry(*opts.cache, key);
+        mycode.dump(entry.stream());
+        entry.stream() << std::endl;
+        entry.commit();
+      }
+    }
+    stats.startPhase("execute");
+    int status = runCode(mycode);
+    stats.endPhase();
+    return finish(status);
+  }
+
+  // write generated code in binary format, each subroutine as soon
+  // as it is generated (the file is created with the first one)
+  if (not binaryOut.empty() and hit) {
+    std::ofstream out(binaryOut, std::ios::binary);
+    out << cached;
+    out.close();
+    stats.endPhase();
+    if (not out) {
+      std::cerr << "Can not write " << binaryOut << std::endl;
+      return finish(EXIT_FAILURE);
+    }
+    return finish(EXIT_SUCCESS);
+  }
+  if (not binaryOut.empty()) {
+    std::ofstream out;
+    std::unique_ptr<bincodeWriter> writer;
+    if (not compile(source, sourceSize, std::cout, std::cerr, stats, opts, [&](subroutine && s) {
+          if (not writer) {
+            out.open(binaryOut, std::ios::binary);
+            writer.reset(new bincodeWriter(out));
+          }
+          writer->add_subroutine(s);
+        }))
+      return finish(EXIT_FAILURE);
+    bool ok = out and writer->finish();
+    if (ok) out.close();
+    if (ok and opts.cache) opts.cache->storeFile(key, binaryOut);
+    stats.endPhase();
+    if (not ok) {
+      std::cerr << "Can not write " << binaryOut << std::endl;
+      return finish(EXIT_FAILURE);
+    }
+    return finish(EXIT_SUCCESS);
+  }
+
+  // print generated code as output, each subroutine as soon as it
+  // is generated (the whole text is never kept in memory: it is
+  // written at the same time in the new entry of the cache)
+  if (hit) {
+    std::cout << cached;
+    stats.endPhase();
+    return finish(EXIT_SUCCESS);
+  }
+  std::unique_ptr<CompileCache::Entry> entry;
+  if (opts.cache) entry.reset(new CompileCache::Entry(*opts.cache, key));
+  if (not compile(source, sourceSize, std::cout, std::cerr, stats, opts, [&](subroutine && s) {
+        s.dump(std::cout);
+        if (entry) s.dump(entry->stream());
+      }))
+    return finish(EXIT_FAILURE);
+  std::cout << std::endl;
+  if (entry) {
+    entry->stream() << std::endl;
+    entry->commit();
+  }
+  stats.endPhase();
+
+  return finish(EXIT_SUCCESS);
+}
@@ -0,0 +1,136 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    aslc - Client of the Asl compiler server (asl --server)
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+// A drop-in replacement of the asl command: it takes the same
+// arguments, and the compilations of a program, with any of the
+// options
+//     --threads <n>  -O0  -O1  -O2  --parse-ll  --parse-stats  --time-report  --stats=json
+// are sent to the server, that answers them without the startup of
+// a process nor of the antlr caches. Anything else (--run, --jobs,
+// ...), or any compilation when no server is running, is done by
+// running asl itself ($ASL, or asl in the PATH).
+//
+//     aslc --shutdown     stops the server
+//
+// The socket is $ASL_SOCKET, or the default one of asl --server.
+
+#include "../common/aslsocket.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>   // execvp, close
+
+
+namespace {
+
+// run asl itself with the same arguments
+int runAsl(char *argv[]) {
+  const char *asl = std::getenv("ASL");
+  if (not asl or not *asl) asl = "asl";
+  argv[0] = const_cast<char *>(asl);
+  execvp(asl, argv);
+  std::cerr << "aslc: can not run " << asl << ": " << std::strerror(errno) << std::endl;
+  return EXIT_FAILURE;
+}
+
+// send a request on the connection fd and write the answer as asl
+// would. Returns false if the server does not answer
+bool request(int fd, const std::string & command, const std::vector<std::string> & options,
+             const std::string & source, int & status) {
+  std::string st, output, errors;
+  bool ok = write_frame(fd, command) and write_frame(fd, join_options(options)) and
+            write_frame(fd, source) and
+            read_frame(fd, st) and read_frame(fd, output) and read_frame(fd, errors);
+  close(fd);
+  if (not ok) return false;
+  std::cout.write(output.data(), output.size());
+  std::cout.flush();
+  std::cerr.write(errors.data(), errors.size());
+  status = std::atoi(st.c_str());
+  return true;
+}
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+  std::string error;
+  int status;
+  if (argc == 2 and std::strcmp(argv[1], "--shutdown") == 0) {
+    int fd = connect_unix(default_socket_path(), error);
+    if (fd < 0 or not request(fd, "shutdown", {}, "", status)) {
+      std::cerr << "aslc: no server running" << std::endl;
+      return EXIT_FAILURE;
+    }
+    return status;
+  }
+
+  // the options the server understands, and the input file
+  std::vector<std::string> options;
+  int i = 1;
+  for (; i < argc and argv[i][0] == '-'; ++i) {
+    if (std::strcmp(argv[i], "--threads") == 0 and i+1 < argc) {
+      options.push_back(argv[i]);
+      options.push_back(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "-O0") == 0 or
+             std::strcmp(argv[i], "-O1") == 0 or
+             std::strcmp(argv[i], "-O2") == 0 or
+             std::strcmp(argv[i], "--parse-ll") == 0 or
+             std::strcmp(argv[i], "--parse-stats") == 0 or
+             std::strcmp(argv[i], "--time-report") == 0 or
+             std::strcmp(argv[i], "--stats=json") == 0)
+      options.push_back(argv[i]);
+    else
+      return runAsl(argv);
+  }
+  if (argc - i > 1) return runAsl(argv);
+
+  // connect before reading std::cin, that asl would need if there
+  // is no server
+  int fd = connect_unix(default_socket_path(), error);
+  if (fd < 0) return runAsl(argv);
+
+  // read the program as asl does: from the file, or from std::cin
+  std::ostringstream source;
+  if (i < argc) {
+    std::ifstream file(argv[i]);
+    if (not file) {
+      std::cout << "No such file: " << argv[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+    source << file.rdbuf();
+  }
+  else
+    source << std::cin.rdbuf();
+
+  if (not request(fd, "compile", options, source.str(), status)) {
+    std::cerr << "aslc: the server did not answer" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return status;
+}
@@ -0,0 +1,283 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    aslgen - Generator of synthetic Asl programs of any size,
+//             to measure the throughput of the compiler
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+// Writes on std::cout a valid (and terminating) Asl program. Its shape
+// follows the grammar in asl/Asl.g4, and it is controlled by:
+//
+//   -f <n>   number of functions (besides main)            [default 10]
+//   -s <n>   statements per function                       [default 50]
+//   -d <n>   maximum depth of the expressions              [default 4]
+//   -a <n>   size of the arrays                            [default 100]
+//   -c <n>   call sites per function                       [default 5]
+//   -r <n>   seed of the random generator                  [default 1]
+//
+// Every function f<k> has the header
+//     func f<k>(n: int, x: float, v: array[A] of int): int
+// and calls only functions f<j> with j < k, and only when n > 0, so
+// the program ends quickly: main calls every function with n = 1.
+// Array indexes are constants below A or loop counters bounded by A,
+// divisions are by non-zero constants, so it runs without errors.
+
+#include <iostream>
+#include <string>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+struct Config {
+  unsigned functions  = 10;
+  unsigned statements = 50;
+  unsigned depth      = 4;
+  unsigned arraySize  = 100;
+  unsigned calls      = 5;
+  unsigned seed       = 1;
+};
+
+class Generator {
+public:
+  Generator(const Config & cfg, std::ostream & os) : cfg(cfg), os(os), rnd(cfg.seed) {}
+
+  void program() {
+    for (unsigned k = 0; k < cfg.functions; ++k) function(k);
+    mainFunction();
+  }
+
+private:
+  const Config & cfg;
+  std::ostream & os;
+  std::mt19937   rnd;
+  // function being generated, and calls left in it
+  unsigned       current = 0;
+  unsigned       callsLeft = 0;
+  // calls are only generated under "if n > 0" and outside loops
+  bool           allowCalls = false;
+  unsigned       loops = 0;
+
+  unsigned pick(unsigned n) { return rnd() % n; }
+  bool     chance(unsigned percent) { return pick(100) < percent; }
+
+  std::string indent(unsigned level) { return std::string(2*level, ' '); }
+
+  std::string index() {
+    if (chance(50)) return std::to_string(pick(cfg.arraySize));
+    return "i % " + std::to_string(cfg.arraySize);
+  }
+
+  // integer expression of depth at most d
+  std::string intExpr(unsigned d) {
+    if (d == 0 or chance(15)) {
+      switch (pick(5)) {
+      case 0:  return std::to_string(pick(1000));
+      case 1:  return "n";
+      case 2:  return "t";
+      case 3:  return "v[" + std::to_string(pick(cfg.arraySize)) + "]";
+      default: return "w[" + index() + "]";
+      }
+    }
+    switch (pick(10)) {
+    case 0:  return "(" + intExpr(d-1) + ")";
+    case 1:  return "-" + intExpr(d-1);
+    case 2:  return intExpr(d-1) + " / " + std::to_string(1 + pick(9));
+    case 3:  return intExpr(d-1) + " % " + std::to_string(1 + pick(9));
+    case 4:  return intExpr(d-1) + " * " + intExpr(d-1);
+    case 5:  if (allowCalls and callsLeft > 0) return call(d);
+             return intExpr(d-1) + " + " + intExpr(d-1);
+    case 6:  return intExpr(d-1) + " - " + intExpr(d-1);
+    default: return "(" + intExpr(d-1) + " + " + intExpr(d-1) + ")";
+    }
+  }
+
+  // call to a previous function
+  std::string call(unsigned d) {
+    --callsLeft;
+    return "f" + std::to_string(pick(current)) + "(n-1, " + floatExpr(d > 0 ? d-1 : 0) + ", w)";
+  }
+
+  // float expression of depth at most d
+  std::string floatExpr(unsigned d) {
+    if (d == 0 or chance(20)) {
+      switch (pick(3)) {
+      case 0:  return std::to_string(pick(100)) + "." + std::to_string(pick(10));
+      case 1:  return "x";
+      default: return "y";
+      }
+    }
+    switch (pick(5)) {
+    case 0:  return "(" + floatExpr(d-1) + ")";
+    case 1:  return floatExpr(d-1) + " * " + floatExpr(d-1);
+    case 2:  return floatExpr(d-1) + " - " + floatExpr(d-1);
+    case 3:  return floatExpr(d-1) + " + " + intExpr(d-1);
+    default: return floatExpr(d-1) + " + " + floatExpr(d-1);
+    }
+  }
+
+  // boolean expression of depth at most d
+  std::string boolExpr(unsigned d) {
+    static const char *rel[] = {"==", "!=", "<", "<=", ">", ">="};
+    if (d == 0 or chance(30)) {
+      if (chance(20)) return chance(50) ? "b" : "true";
+      return intExpr(d > 0 ? d-1 : 0) + " " + rel[pick(6)] + " " + intExpr(d > 0 ? d-1 : 0);
+    }
+    switch (pick(3)) {
+    case 0:  return "not (" + boolExpr(d-1) + ")";
+    case 1:  return "(" + boolExpr(d-1) + ") and (" + boolExpr(d-1) + ")";
+    default: return "(" + boolExpr(d-1) + ") or (" + boolExpr(d-1) + ")";
+    }
+  }
+
+  // one statement (it may be compound, counting as several)
+  void statement(unsigned level, unsigned & left) {
+    std::string in = indent(level);
+    --left;
+    unsigned kind = pick(100);
+    if (kind < 30)
+      os << in << "t = " << intExpr(cfg.depth) << ";\n";
+    else if (kind < 40)
+      os << in << "y = " << floatExpr(cfg.depth) << ";\n";
+    else if (kind < 50)
+      os << in << "w[" << pick(cfg.arraySize) << "] = " << intExpr(cfg.depth) << ";\n";
+    else if (kind < 55)
+      os << in << "b = " << boolExpr(cfg.depth) << ";\n";
+    else if (kind < 60)
+      os << in << "c = '" << char('a' + pick(26)) << "';\n";
+    else if (kind < 70 and level < 4) {
+      os << in << "if " << boolExpr(cfg.depth) << " then\n";
+      block(level+1, left);
+      if (chance(50)) {
+        os << in << "else\n";
+        block(level+1, left);
+      }
+      os << in << "endif\n";
+    }
+    else if (kind < 78 and level < 3) {
+      // a bounded loop over the array
+      os << in << "i = 0;\n";
+      os << in << "while i < " << cfg.arraySize << " do\n";
+      os << in << "  w[i] = " << intExpr(cfg.depth > 1 ? cfg.depth-1 : 0) << ";\n";
+      ++loops;
+      block(level+1, left);
+      --loops;
+      os << in << "  i = i + 1;\n";
+      os << in << "endwhile\n";
+    }
+    else if (kind < 88 and callsLeft > 0 and current > 0 and loops == 0)
+      guardedCall(level);
+    else if (kind < 92)
+      os << in << "write " << (chance(50) ? "t" : "\"t\\n\"") << ";\n";
+    else
+      os << in << "w[i % " << cfg.arraySize << "] = v[" << pick(cfg.arraySize) << "] + t;\n";
+  }
+
+  // "if n > 0 then t = ... endif", with one or more calls
+  void guardedCall(unsigned level) {
+    std::string in = indent(level);
+    allowCalls = true;
+    std::string e = call(cfg.depth);
+    if (chance(50)) e += " + " + intExpr(cfg.depth);
+    allowCalls = false;
+    os << in << "if n > 0 then\n";
+    os << in << "  t = t + " << e << ";\n";
+    os << in << "endif\n";
+  }
+
+  // a short list of statements inside a compound statement
+  void block(unsigned level, unsigned & left) {
+    unsigned n = 1 + pick(3);
+    for (unsigned k = 0; k < n and left > 0; ++k) statement(level, left);
+  }
+
+  void declarations() {
+    os << "  var i, t: int\n";
+    os << "  var y: float\n";
+    os << "  var b: bool\n";
+    os << "  var c: char\n";
+    os << "  var w: array[" << cfg.arraySize << "] of int\n";
+  }
+
+  void function(unsigned k) {
+    current = k;
+    callsLeft = cfg.calls;
+    os << "func f" << k << "(n: int, x: float, v: array[" << cfg.arraySize
+       << "] of int): int\n";
+    declarations();
+    os << "  i = 0;\n  t = 0;\n  y = x;\n  b = false;\n";
+    os << "  while i < " << cfg.arraySize << " do\n";
+    os << "    w[i] = v[i] + i;\n";
+    os << "    i = i + 1;\n";
+    os << "  endwhile\n";
+    unsigned left = cfg.statements;
+    while (left > 0) statement(1, left);
+    // the calls that did not fit in the statements
+    while (callsLeft > 0 and k > 0) guardedCall(1);
+    os << "  return t % 1000;\n";
+    os << "endfunc\n\n";
+  }
+
+  void mainFunction() {
+    os << "func main()\n";
+    declarations();
+    os << "  i = 0;\n  t = 0;\n  y = 1.5;\n";
+    os << "  while i < " << cfg.arraySize << " do\n";
+    os << "    w[i] = i;\n";
+    os << "    i = i + 1;\n";
+    os << "  endwhile\n";
+    for (unsigned k = 0; k < cfg.functions; ++k)
+      os << "  t = t + f" << k << "(1, y, w);\n";
+    os << "  write t;\n";
+    os << "  write \"\\n\";\n";
+    os << "endfunc\n";
+  }
+};
+
+void usage(const char *prog) {
+  std::cerr << "Usage: " << prog
+            << " [-f functions] [-s statements] [-d depth] [-a arraysize]"
+            << " [-c calls] [-r seed]" << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+  Config cfg;
+  for (int i = 1; i < argc; i += 2) {
+    if (i+1 >= argc or std::strlen(argv[i]) != 2 or argv[i][0] != '-') usage(argv[0]);
+    char *end;
+    unsigned long v = std::strtoul(argv[i+1], &end, 10);
+    if (*end != '\0') usage(argv[0]);
+    switch (argv[i][1]) {
+    case 'f': cfg.functions  = v; break;
+    case 's': cfg.statements = v; break;
+    case 'd': cfg.depth      = v; break;
+    case 'a': cfg.arraySize  = v > 0 ? v : 1; break;
+    case 'c': cfg.calls      = v; break;
+    case 'r': cfg.seed       = v; break;
+    default:  usage(argv[0]);
+    }
+  }
+  std::ios::sync_with_stdio(false);
+  Generator gen(cfg, std::cout);
+  gen.program();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+/////////////////////////////////////////////////////////////////
+//
+//    decoration_bench - micro-benchmark of the cost of reading and
+//                       writing tree decorations: ParseTreeProperty
+//                       (pointer-keyed map) versus the dense side
+//                       table of TreeDecoration
+//
+//    Usage: ./decoration_bench [<number of nodes>] [<rounds>]
+//
+////////////////////////////////////////////////////////////////
+
+#include "antlr4-runtime.h"
+#include "tree/ParseTreeProperty.h"
+
+#include "../common/TypesMgr.h"
+#include "../common/TreeDecoration.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+
+// A synthetic parse tree, shaped like the expressions of a long
+// statement list: every internal node has two children
+static DecoratedRuleContext *buildTree(std::size_t n,
+                                       std::vector<antlr4::ParserRuleContext *> &nodes) {
+  nodes.clear();
+  nodes.reserve(n);
+  DecoratedRuleContext *root = new DecoratedRuleContext;
+  nodes.push_back(root);
+  for (std::size_t i = 1; i < n; ++i) {
+    DecoratedRuleContext *node = new DecoratedRuleContext;
+    antlr4::ParserRuleContext *parent = nodes[(i-1)/2];
+    node->parent = parent;
+    parent->children.push_back(node);
+    nodes.push_back(node);
+  }
+  return root;
+}
+
+// Walk the nodes as the visitors do: one put and a few gets per
+// node (getTypeDecor is called several times per expression)
+template <class PUT, class GET>
+static double run(const std::vector<antlr4::ParserRuleContext *> &nodes,
+                  unsigned rounds, PUT put, GET get, TypesMgr::TypeId &check) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned r = 0; r < rounds; ++r) {
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+      put(nodes[i], TypesMgr::TypeId(i & 7));
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+      check += get(nodes[i]);
+      check += get(nodes[i]);
+      check += get(nodes[(i-1)/2 % nodes.size()]);
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  return ns / (double(rounds) * nodes.size() * 4);   // per access
+}
+
+
+int main(int argc, const char* argv[]) {
+  std::size_t n = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  unsigned rounds = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 5;
+  if (n == 0 or rounds == 0) {
+    std::cout << "Usage: ./decoration_bench [<number of nodes>] [<rounds>]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<antlr4::ParserRuleContext *> nodes;
+  DecoratedRuleContext *root = buildTree(n, nodes);
+  TypesMgr::TypeId check = 0;
+
+  antlr4::tree::ParseTreeProperty<TypesMgr::TypeId> property;
+  double tProp = run(nodes, rounds,
+                     [&](antlr4::ParserRuleContext *c, TypesMgr::TypeId t) { property.put(c, t); },
+                     [&](antlr4::ParserRuleContext *c) { return property.get(c); },
+                     check);
+
+  TreeDecoration decorations;
+  auto t0 = std::chrono::steady_clock::now();
+  decorations.indexTree(root);
+  auto t1 = std::chrono::steady_clock::now();
+  double tIndex = std::chrono::duration<double, std::milli>(t1 - t0).count();
+  double tDense = run(nodes, rounds,
+                      [&](antlr4::ParserRuleContext *c, TypesMgr::TypeId t) { decorations.putType(c, t); },
+                      [&](antlr4::ParserRuleContext *c) { return decorations.getType(c); },
+                      check);
+
+  std::cout << "nodes:                  " << n << std::endl;
+  std::cout << "ParseTreeProperty:      " << tProp << " ns/access" << std::endl;
+  std::cout << "TreeDecoration (dense): " << tDense << " ns/access" << std::endl;
+  std::cout << "indexTree pre-pass:     " << tIndex << " ms" << std::endl;
+  std::cout << "speedup:                " << tProp / tDense << "x"
+            << "   (checksum " << check << ")" << std::endl;
+
+  delete root;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#!/bin/bash
+# =================================================
+#  Compile-throughput benchmark of the asl compiler
+#
+#  Usage: ./run-bench.sh [-n runs] [-o results] [-x flags] [asl]
+#    -n runs     runs of each program (the fastest one is kept) [3]
+#    -o results  file where results are appended   [results.jsonl]
+#    -x flags    extra options for asl (e.g. --parse-ll)        []
+#    asl         compiler to measure                 [../asl/asl]
+#
+#  Generates a fixed set of programs with ./aslgen, compiles each
+#  one with "asl --stats=json" and appends one JSON line per program
+#  and phase to the results file:
+#    {"commit": ..., "date": ..., "flags": ..., "program": ...,
+#     "lines": ..., "phase": ..., "wall_ms": ..., "lines_per_s": ...,
+#     "allocations": ..., "peak_rss_kb": ...}
+#  The "total" phase is the sum of all the phases. For instance, the
+#  gain of parsing with SLL first is the difference of the "parse"
+#  (plus "parse-ll") lines of a run with "-x --parse-ll" and without.
+#  With -O1 or -O2 it also appends one line per optimization pass:
+#    {"commit": ..., "date": ..., "flags": ..., "program": ...,
+#     "lines": ..., "pass": ..., "wall_ms": ..., "runs": ..., "changes": ...}
+#  Passes run inside the "codegen" phase, so they are not added to
+#  the total.
+# =================================================
+
+RUNS=3
+RESULTS=results.jsonl
+FLAGS=""
+while getopts "n:o:x:" opt; do
+    case $opt in
+        n) RUNS=$OPTARG ;;
+        o) RESULTS=$OPTARG ;;
+        x) FLAGS=$OPTARG ;;
+        *) sed -n '5,9p' "$0"; exit 1 ;;
+    esac
+done
+shift $((OPTIND-1))
+ASL=${1:-../asl/asl}
+
+if [ ! -x ./aslgen ] || [ ! -x "$ASL" ]; then
+    echo "Build ./aslgen (make) and $ASL first"
+    exit 1
+fi
+
+# name and aslgen options of each program
+PROGRAMS=(
+    "small      -f 10   -s 50"
+    "medium     -f 100  -s 200"
+    "large      -f 1000 -s 200"
+    "longfuncs  -f 10   -s 20000"
+    "hugefunc   -f 1    -s 100000"
+    "deepexprs  -f 100  -s 100 -d 10"
+    "bigarrays  -f 100  -s 200 -a 100000"
+    "manycalls  -f 200  -s 100 -c 100"
+)
+
+# the objects of the "phases" (or "passes") array of a --stats=json
+# file, one per line
+phases() {
+    sed -n 's/.*"phases": \[\([^]]*\)\].*/\1/p' "$1" | grep -o '{"name": [^}]*}'
+}
+passes() {
+    sed -n 's/.*"passes": \[\([^]]*\)\].*/\1/p' "$1" | grep -o '{"name": [^}]*}'
+}
+
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+DATE=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+for p in "${PROGRAMS[@]}"; do
+    set -- $p
+    name=$1; shift
+    ./aslgen "$@" > "$TMP/$name.asl"
+    lines=$(wc -l < "$TMP/$name.asl")
+    bestms=""
+    for ((r = 0; r < RUNS; r++)); do
+        "$ASL" $FLAGS --stats=json "$TMP/$name.asl" 2> "$TMP/stats" > /dev/null
+        phases "$TMP/stats" > "$TMP/phases"
+        codegen=$(sed -n 's/.*"name": "codegen", "wall_ms": \([0-9.]*\).*/\1/p' "$TMP/phases")
+        total=$(grep -o '"wall_ms": [0-9.]*' "$TMP/phases" | awk '{s += $2} END {print s}')
+        if [ -z "$codegen" ]; then
+            echo "$name: compilation failed" >&2
+            continue 2
+        fi
+        if [ -z "$bestms" ] || awk "BEGIN {exit !($total < $bestms)}"; then
+            bestms=$total
+            cp "$TMP/stats" "$TMP/best"
+        fi
+    done
+    # one line per phase, and the total
+    phases "$TMP/best" | \
+    awk -v commit="$COMMIT" -v date="$DATE" -v flags="$FLAGS" -v prog="$name" -v lines="$lines" '
+        {
+            match($0, /"name": "[^"]*"/);        ph = substr($0, RSTART+9, RLENGTH-10)
+            match($0, /"wall_ms": [0-9.]+/);     ms = substr($0, RSTART+11, RLENGTH-11)
+            match($0, /"allocations": [0-9]+/);  al = substr($0, RSTART+15, RLENGTH-15)
+            match($0, /"peak_rss_kb": [0-9]+/);  kb = substr($0, RSTART+15, RLENGTH-15)
+            out(ph, ms, al, kb)
+            tms += ms; tal += al; if (kb+0 > tkb+0) tkb = kb
+        }
+        END { out("total", tms, tal, tkb) }
+        function out(ph, ms, al, kb) {
+            printf "{\"commit\": \"%s\", \"date\": \"%s\", \"flags\": \"%s\", ", commit, date, flags
+            printf "\"program\": \"%s\", \"lines\": %d, ", prog, lines
+            printf "\"phase\": \"%s\", \"wall_ms\": %.3f, \"lines_per_s\": %.0f, ", ph, ms, (ms > 0 ? lines / (ms / 1000) : 0)
+            printf "\"allocations\": %d, \"peak_rss_kb\": %d}\n", al, kb
+        }' | tee -a "$RESULTS"
+    # one line per optimization pass
+    passes "$TMP/best" | \
+    awk -v commit="$COMMIT" -v date="$DATE" -v flags="$FLAGS" -v prog="$name" -v lines="$lines" '
+        {
+            match($0, /"name": "[^"]*"/);        ps = substr($0, RSTART+9, RLENGTH-10)
+            match($0, /"wall_ms": [0-9.]+/);     ms = substr($0, RSTART+11, RLENGTH-11)
+            match($0, /"runs": [0-9]+/);         rn = substr($0, RSTART+8, RLENGTH-8)
+            match($0, /"changes": [0-9]+/);      ch = substr($0, RSTART+11, RLENGTH-11)
+            printf "{\"commit\": \"%s\", \"date\": \"%s\", \"flags\": \"%s\", ", commit, date, flags
+            printf "\"program\": \"%s\", \"lines\": %d, ", prog, lines
+            printf "\"pass\": \"%s\", \"wall_ms\": %.3f, \"runs\": %d, \"changes\": %d}\n", ps, ms, rn, ch
+        }' | tee -a "$RESULTS"
+done
@@ -0,0 +1,247 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    CompileCache - Content-addressed cache of the code generated
+//                   for Asl programs (asl --cache-dir)
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "CompileCache.h"
+
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cctype>     // isxdigit
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+using namespace std;
+
+
+// version of the format of the entries
+static const char *CacheFormat = "asl-cache-1";
+
+// the identity of this compiler: its executable (size, time and
+// inode), or the time this file was compiled if it is not available
+static string compilerIdentity() {
+  struct stat st;
+  ostringstream id;
+  id << CacheFormat << ' ';
+  if (stat("/proc/self/exe", &st) == 0)
+    id << st.st_size << ' ' << st.st_mtime << ' ' << st.st_ino;
+  else
+    id << __DATE__ << ' ' << __TIME__;
+  return id.str();
+}
+
+// FNV-1a hash of 128 bits
+class Hash128 {
+public:
+  void add(const char *data, size_t size) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i) {
+      H ^= p[i];
+      // the prime is 2^88 + 0x13b
+      H = (H << 88) + H * 0x13b;
+    }
+  }
+  void add(const string & s) {
+    add(s.data(), s.size() + 1);  // with the '\0', as a separator
+  }
+  string hex() const {
+    char text[33];
+    snprintf(text, sizeof(text), "%016llx%016llx",
+             (unsigned long long)(H >> 64), (unsigned long long)H);
+    return text;
+  }
+private:
+  unsigned __int128 H = ((unsigned __int128)0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL;
+};
+
+// true if 'name' is the file of an entry (32 hexadecimal digits)
+static bool isEntryName(const char *name) {
+  size_t n = 0;
+  for (; name[n]; ++n)
+    if (not isxdigit((unsigned char)name[n])) return false;
+  return n == 32;
+}
+
+// the entries in 'dir': (time of last use, size, path)
+struct CacheFile {
+  long long mtime;  // ns
+  size_t size;
+  string path;
+};
+
+static vector<CacheFile> listEntries(const string & dir) {
+  vector<CacheFile> files;
+  DIR *d = opendir(dir.c_str());
+  if (not d) return files;
+  while (struct dirent *e = readdir(d)) {
+    if (not isEntryName(e->d_name)) continue;
+    string path = dir + "/" + e->d_name;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 and S_ISREG(st.st_mode))
+      files.push_back(CacheFile{st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec,
+                                (size_t)st.st_size, path});
+  }
+  closedir(d);
+  return files;
+}
+
+
+CompileCache::CompileCache(const string & dir, size_t maxBytes) :
+  Dir{dir.empty() ? "." : dir}, MaxBytes{maxBytes}, CompilerId{compilerIdentity()} {
+}
+
+bool CompileCache::open() {
+  if (mkdir(Dir.c_str(), 0700) != 0 and errno != EEXIST) {
+    Error = "Can not create the cache directory " + Dir + ": " + strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (stat(Dir.c_str(), &st) != 0 or not S_ISDIR(st.st_mode)) {
+    Error = "Not a directory: " + Dir;
+    return false;
+  }
+  lock_guard<mutex> guard(SizeLock);
+  TotalBytes = 0;
+  for (auto & f : listEntries(Dir)) TotalBytes += f.size;
+  return true;
+}
+
+const string & CompileCache::getError() const {
+  return Error;
+}
+
+string CompileCache::getKey(const char *data, size_t size, const string & options) const {
+  Hash128 h;
+  h.add(CompilerId);
+  h.add(options);
+  h.add(to_string(size));
+  h.add(data, size);
+  return h.hex();
+}
+
+string CompileCache::entryPath(const string & key) const {
+  return Dir + "/" + key;
+}
+
+bool CompileCache::fetch(const string & key, string & data) {
+  // the entry may be evicted by another process at any moment: once
+  // opened, it can be read anyway
+  string path = entryPath(key);
+  ifstream in(path, ios::binary);
+  if (in) {
+    ostringstream text;
+    text << in.rdbuf();
+    if (not in.bad()) {
+      data = text.str();
+      // it is now the most recently used
+      utimes(path.c_str(), nullptr);
+      ++Hits;
+      return true;
+    }
+  }
+  ++Misses;
+  return false;
+}
+
+CompileCache::Entry::Entry(CompileCache & cache, const string & key) :
+  Cache(cache), Path{cache.entryPath(key)} {
+  TempPath = cache.Dir + "/.tmp-" + to_string(getpid()) + "-" + to_string(cache.TempCount++);
+  Out.open(TempPath, ios::binary);
+}
+
+CompileCache::Entry::~Entry() {
+  if (not Committed) {
+    Out.close();
+    remove(TempPath.c_str());
+  }
+}
+
+ostream & CompileCache::Entry::stream() {
+  return Out;
+}
+
+bool CompileCache::Entry::commit() {
+  Out.close();
+  struct stat st;
+  if (not Out or stat(TempPath.c_str(), &st) != 0 or rename(TempPath.c_str(), Path.c_str()) != 0)
+    return false;
+  Committed = true;
+  ++Cache.Stores;
+  Cache.added(st.st_size);
+  return true;
+}
+
+bool CompileCache::storeFile(const string & key, const string & path) {
+  ifstream in(path, ios::binary);
+  if (not in) return false;
+  Entry entry(*this, key);
+  entry.stream() << in.rdbuf();
+  return entry.commit();
+}
+
+void CompileCache::added(size_t bytes) {
+  lock_guard<mutex> guard(SizeLock);
+  TotalBytes += bytes;
+  if (TotalBytes > MaxBytes) evict();
+}
+
+void CompileCache::evict() {
+  vector<CacheFile> files = listEntries(Dir);
+  sort(files.begin(), files.end(), [](const CacheFile & a, const CacheFile & b) {
+      return a.mtime < b.mtime;
+    });
+  TotalBytes = 0;
+  for (auto & f : files) TotalBytes += f.size;
+  for (auto & f : files) {
+    if (TotalBytes <= MaxBytes) break;
+    if (remove(f.path.c_str()) == 0) {
+      TotalBytes -= f.size;
+      ++Evicted;
+    }
+  }
+}
+
+void CompileCache::printStats(ostream & os) {
+  vector<CacheFile> files = listEntries(Dir);
+  size_t bytes = 0;
+  for (auto & f : files) bytes += f.size;
+  size_t hits = Hits, misses = Misses;
+  char line[200];
+  snprintf(line, sizeof(line),
+           ": %zu hits, %zu misses (%.1f%% hits), %zu stored, %zu evicted; "
+           "%zu entries, %zu KB of %zu KB\n",
+           hits, misses, hits + misses ? 100.0 * hits / (hits + misses) : 0.0,
+           (size_t)Stores, (size_t)Evicted, files.size(), bytes / 1024, MaxBytes / 1024);
+  os << "cache " << Dir << line;
+}
+
+size_t CompileCache::getHits() const {
+  return Hits;
+}
+
+size_t CompileCache::getMisses() const {
+  return Misses;
+}
@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    CompileCache - Content-addressed cache of the code generated
+//                   for Asl programs (asl --cache-dir)
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <cstddef>
+
+
+//////////////////////////////////////////////////////////////////////
+// Class CompileCache: a directory with the output of previous
+// compilations (t-code text or binary), each one in a file named by
+// a key: a hash of the source bytes, the options that change the
+// output and the compiler itself (its executable), so that a new
+// build of the compiler never uses the entries of an older one.
+//
+// Entries are written in a temporary file and renamed, so several
+// threads and processes can use the same directory at the same time.
+// When the entries exceed the size limit, the least recently used
+// ones are removed (using an entry updates its modification time).
+
+class CompileCache {
+
+public:
+  // Constructor: the cache in 'dir', limited to 'maxBytes' bytes
+  CompileCache(const std::string & dir, std::size_t maxBytes);
+
+  // Create the directory if needed. Returns false (with the reason
+  // in getError) if it can not be used
+  bool open ();
+  const std::string & getError () const;
+
+  // The key of a program (its 'size' bytes in 'data') compiled with
+  // 'options' (anything that changes the output, e.g. its format)
+  std::string getKey (const char *data, std::size_t size, const std::string & options) const;
+
+  // Get the entry of 'key' in 'data'. Returns false on a miss
+  bool fetch (const std::string & key, std::string & data);
+
+  // Class Entry: a new entry being written, that is only added to
+  // the cache by commit (it is discarded otherwise)
+  class Entry {
+  public:
+    Entry(CompileCache & cache, const std::string & key);
+    ~Entry();
+    Entry(const Entry &) = delete;
+    Entry & operator=(const Entry &) = delete;
+
+    std::ostream & stream ();
+    bool           commit ();
+
+  private:
+    CompileCache & Cache;
+    std::string    TempPath, Path;
+    std::ofstream  Out;
+    bool           Committed = false;
+  };
+
+  // Add the contents of the file 'path' as the entry of 'key'
+  bool storeFile (const std::string & key, const std::string & path);
+
+  // Print the hits and misses of this process, and the entries in
+  // the directory
+  void printStats (std::ostream & os = std::cerr);
+
+  std::size_t getHits   () const;
+  std::size_t getMisses () const;
+
+private:
+  // path of the entry of 'key'
+  std::string entryPath (const std::string & key) const;
+  // account a new entry of 'bytes' bytes, evicting the least
+  // recently used ones if the cache is too big
+  void added (std::size_t bytes);
+  // remove the oldest entries until they fit in MaxBytes
+  void evict ();
+
+  std::string              Dir;
+  std::size_t              MaxBytes;
+  std::string              CompilerId;
+  std::string              Error;
+  std::atomic<std::size_t> Hits{0}, Misses{0}, Stores{0}, Evicted{0};
+  std::atomic<unsigned>    TempCount{0};
+  // bytes in the directory (an estimate: other processes may write)
+  std::mutex               SizeLock;
+  std::size_t              TotalBytes = 0;
+
+};  // class CompileCache
@@ -0,0 +1,171 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    PhaseStats - Time and memory used by each phase of
+//                 the Asl compiler
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "PhaseStats.h"
+
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+
+#include <sys/resource.h>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Allocation counter: the global operator new is replaced by one
+// that counts the calls (the array and nothrow versions end up
+// calling this one). Every thread has its own counter, so a phase
+// does not count what other compilations (--jobs, --server) allocate
+// at the same time; a WorkPool adds what its workers allocated to the
+// thread that ran it (see addAllocations).
+
+static thread_local std::size_t NumAllocations = 0;
+
+void * operator new(std::size_t size) {
+  ++NumAllocations;
+  if (size == 0) size = 1;
+  while (true) {
+    void *p = std::malloc(size);
+    if (p) return p;
+    std::new_handler h = std::get_new_handler();
+    if (not h) throw std::bad_alloc();
+    h();
+  }
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+
+//////////////////////////////////////////////////////////////////////
+// PhaseStats
+
+std::size_t PhaseStats::getAllocations() {
+  return NumAllocations;
+}
+
+void PhaseStats::addAllocations(std::size_t n) {
+  NumAllocations += n;
+}
+
+std::size_t PhaseStats::getPeakRSS() {
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+  return ru.ru_maxrss;    // KB on Linux
+}
+
+void PhaseStats::startPhase(const std::string & name) {
+  endPhase();
+  Running = true;
+  CurrName = name;
+  CurrAllocs = getAllocations();
+  CurrStart = Clock::now();
+}
+
+void PhaseStats::endPhase() {
+  if (not Running) return;
+  Clock::time_point end = Clock::now();
+  Phase ph;
+  ph.name = CurrName;
+  ph.wallMs = std::chrono::duration<double, std::milli>(end - CurrStart).count();
+  ph.allocations = getAllocations() - CurrAllocs;
+  ph.peakRSS = getPeakRSS();
+  Phases.push_back(ph);
+  Running = false;
+}
+
+void PhaseStats::setCounter(const std::string & name, std::size_t value) {
+  for (auto & c : Counters)
+    if (c.first == name) {
+      c.second = value;
+      return;
+    }
+  Counters.push_back(std::make_pair(name, value));
+}
+
+void PhaseStats::addPass(const std::string & name, double wallMs,
+                         std::size_t runs, std::size_t changes) {
+  Pass p;
+  p.name = name;
+  p.wallMs = wallMs;
+  p.runs = runs;
+  p.changes = changes;
+  Passes.push_back(p);
+}
+
+void PhaseStats::printReport(std::ostream & os) const {
+  char line[128];
+  // the peak RSS is the one of the whole process
+  std::snprintf(line, sizeof(line), "%-14s %12s %12s %14s\n",
+                "phase", "wall (ms)", "allocations", "peak RSS (KB)");
+  os << line;
+  double totalMs = 0;
+  std::size_t totalAllocs = 0, peak = 0;
+  for (auto & ph : Phases) {
+    std::snprintf(line, sizeof(line), "%-14s %12.3f %12zu %14zu\n",
+                  ph.name.c_str(), ph.wallMs, ph.allocations, ph.peakRSS);
+    os << line;
+    totalMs += ph.wallMs;
+    totalAllocs += ph.allocations;
+    if (ph.peakRSS > peak) peak = ph.peakRSS;
+  }
+  std::snprintf(line, sizeof(line), "%-14s %12.3f %12zu %14zu\n",
+                "total", totalMs, totalAllocs, peak);
+  os << line;
+  if (not Passes.empty()) {
+    std::snprintf(line, sizeof(line), "%-17s %9s %12s %14s\n",
+                  "pass", "wall (ms)", "runs", "changes");
+    os << line;
+  }
+  for (auto & p : Passes) {
+    std::snprintf(line, sizeof(line), "%-17s %9.3f %12zu %14zu\n",
+                  p.name.c_str(), p.wallMs, p.runs, p.changes);
+    os << line;
+  }
+  for (auto & c : Counters) {
+    std::snprintf(line, sizeof(line), "%-14s %12zu\n", c.first.c_str(), c.second);
+    os << line;
+  }
+}
+
+void PhaseStats::printJSON(std::ostream & os) const {
+  char num[32];
+  os << "{\"phases\": [";
+  for (std::size_t i = 0; i < Phases.size(); ++i) {
+    const Phase & ph = Phases[i];
+    std::snprintf(num, sizeof(num), "%.3f", ph.wallMs);
+    os << (i ? ", " : "") << "{\"name\": \"" << ph.name << "\", \"wall_ms\": " << num
+       << ", \"allocations\": " << ph.allocations
+       << ", \"peak_rss_kb\": " << ph.peakRSS << "}";
+  }
+  os << "], \"passes\": [";
+  for (std::size_t i = 0; i < Passes.size(); ++i) {
+    const Pass & p = Passes[i];
+    std::snprintf(num, sizeof(num), "%.3f", p.wallMs);
+    os << (i ? ", " : "") << "{\"name\": \"" << p.name << "\", \"wall_ms\": " << num
+       << ", \"runs\": " << p.runs << ", \"changes\": " << p.changes << "}";
+  }
+  os << "], \"counters\": {";
+  for (std::size_t i = 0; i < Counters.size(); ++i)
+    os << (i ? ", " : "") << "\"" << Counters[i].first << "\": " << Counters[i].second;
+  os << "}}" << std::endl;
+}
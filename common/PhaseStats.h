@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    PhaseStats - Time and memory used by each phase of
+//                 the Asl compiler
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <iostream>
+#include <cstddef>
+
+
+//////////////////////////////////////////////////////////////////////
+// Class PhaseStats: measures the phases of a compilation (lexing,
+// parsing, each visitor, ...). For every phase it keeps:
+//   - the wall time
+//   - the number of memory allocations (operator new) done in it by
+//     the thread that measures it and by the workers of the WorkPools
+//     it runs (not by other threads of the process)
+//   - the peak resident set size of the whole process at its end
+//     (with --jobs, --threads or --server it includes the memory of
+//     the other compilations running at the same time)
+// and it also keeps named counters of the compiled program (tokens,
+// tree nodes, types, symbols, instructions, ...), and the time of each
+// optimization pass (which runs inside the code generation phase).
+//
+// Phases are consecutive: starting a phase ends the current one.
+
+class PhaseStats {
+
+public:
+  // Constructor
+  PhaseStats() = default;
+
+  // End the current phase (if any) and start a new one
+  void startPhase (const std::string & name);
+  // End the current phase (if any)
+  void endPhase   ();
+
+  // Set the value of a counter (in the order they are first set)
+  void setCounter (const std::string & name, std::size_t value);
+
+  // Add an optimization pass: its total time, the number of
+  // subroutines it ran on and how many of them it changed
+  void addPass    (const std::string & name, double wallMs,
+                   std::size_t runs, std::size_t changes);
+
+  // Print a human readable table
+  void printReport (std::ostream & os = std::cerr) const;
+  // Print the same information as a JSON object
+  void printJSON   (std::ostream & os = std::cerr) const;
+
+  // Number of allocations done by the calling thread so far
+  static std::size_t getAllocations ();
+  // Count n more allocations in the calling thread (the ones of the
+  // workers it waited for)
+  static void        addAllocations (std::size_t n);
+  // Peak resident set size of the process so far, in KB
+  static std::size_t getPeakRSS     ();
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Phase {
+    std::string name;
+    double      wallMs;
+    std::size_t allocations;
+    std::size_t peakRSS;
+  };
+
+  struct Pass {
+    std::string name;
+    double      wallMs;
+    std::size_t runs;
+    std::size_t changes;
+  };
+
+  std::vector<Phase>                                 Phases;
+  std::vector<Pass>                                  Passes;
+  std::vector<std::pair<std::string, std::size_t>>   Counters;
+  // the phase being measured
+  bool                                               Running = false;
+  std::string                                        CurrName;
+  Clock::time_point                                  CurrStart;
+  std::size_t                                        CurrAllocs = 0;
+
+};  // class PhaseStats
@@ -37,9 +37,12 @@
 // using namespace std;
 
 
+SemErrors::SemErrors(std::ostream & os) : Output(os) {
+}
+
 void SemErrors::print() {
   std::sort(ErrorList.begin(), ErrorList.end(), less);  
-  for (auto & error : ErrorList) error.print();
+  for (auto & error : ErrorList) error.print(Output);
 }
 
 bool SemErrors::less(const ErrorInfo & e1, const ErrorInfo & e2) {
@@ -47,6 +50,10 @@ bool SemErrors::less(const ErrorInfo & e1, const ErrorInfo & e2) {
   return e1.getLine() < e2.getLine();
 }
 
+void SemErrors::append(const SemErrors & other) {
+  ErrorList.insert(ErrorList.end(), other.ErrorList.begin(), other.ErrorList.end());
+}
+
 std::size_t SemErrors::getNumberOfSemanticErrors() const {
   return ErrorList.size();
 }
@@ -149,8 +156,8 @@ SemErrors::ErrorInfo::ErrorInfo(std::size_t line, std::size_t coln, std::string
   : line{line}, coln{coln}, message{message} {
 }
 
-void SemErrors::ErrorInfo::print() const {
-  std::cout << "Line " << line << ":" << coln << " error: " << message << std::endl;
+void SemErrors::ErrorInfo::print(std::ostream & os) const {
+  os << "Line " << line << ":" << coln << " error: " << message << std::endl;
 }
 
 std::size_t SemErrors::ErrorInfo::getLine() const {
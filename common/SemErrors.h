@@ -32,6 +32,7 @@
 
 #include <string>
 #include <vector>
+#include <iostream>
 
 // using namespace std;
 
@@ -44,17 +45,22 @@
 //   - TypeCheckVisitor
 // Semantic errors emitted are kept in a vector and when the
 // typecheck finishes they will be printed (sorted by line/column number)
+// on the stream given to the constructor
 
 class SemErrors {
 
 public:
 
-  // Constructor
-  SemErrors() = default;
+  // Constructor (errors are printed on os)
+  SemErrors(std::ostream & os = std::cout);
 
   // Write the semantic errors ordered by line number
   void print ();
 
+  // Add the errors kept in other (e.g. the ones found by another
+  // thread). They are sorted with the rest when printed
+  void append (const SemErrors & other);
+
   // Accessor to get the number of semantic errors
   std::size_t getNumberOfSemanticErrors () const;
 
@@ -114,7 +120,7 @@ private:
     ErrorInfo(std::size_t line, std::size_t coln, std::string message);
     std::size_t getLine() const;
     std::size_t getColumnInLine() const;
-    void print() const;
+    void print(std::ostream & os) const;
   private:
     std::size_t line, coln;
     std::string message;
@@ -123,6 +129,9 @@ private:
   // List of semantic errors
   std::vector<ErrorInfo> ErrorList;
 
+  // Stream where the errors are printed
+  std::ostream & Output;
+
   // Compare two errors to determine the order (needed in print)
   static bool less(const ErrorInfo & e1, const ErrorInfo & e2);
 
@@ -0,0 +1,150 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    SourceInput - Reading Asl programs without copying them:
+//                  files mapped in memory and a character stream
+//                  for the lexer over their bytes
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "SourceInput.h"
+
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// MappedFile
+
+MappedFile::~MappedFile() {
+  if (Mapped) munmap(const_cast<char *>(Data), Size);
+}
+
+bool MappedFile::open(const std::string & path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    NotFound = errno == ENOENT;
+    Error = "Can not open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 or not S_ISREG(st.st_mode)) {
+    ::close(fd);
+    Error = "Can not read " + path;
+    return false;
+  }
+  // an empty file can not be mapped (and there is nothing to map)
+  if (st.st_size > 0) {
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      ::close(fd);
+      Error = "Can not map " + path + ": " + std::strerror(errno);
+      return false;
+    }
+    // the lexer reads it from the beginning to the end
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    Data = (const char *)p;
+    Size = st.st_size;
+    Mapped = true;
+  }
+  ::close(fd);
+  return true;
+}
+
+const char * MappedFile::getData() const {
+  return Data;
+}
+
+std::size_t MappedFile::getSize() const {
+  return Size;
+}
+
+const std::string & MappedFile::getError() const {
+  return Error;
+}
+
+bool MappedFile::notFound() const {
+  return NotFound;
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// ByteCharStream
+
+ByteCharStream::ByteCharStream(const char *data, std::size_t size, const std::string & name) :
+  Data{data}, Size{size}, Name{name} {
+}
+
+bool ByteCharStream::isAscii(const char *data, std::size_t size) {
+  unsigned char bits = 0;
+  for (std::size_t i = 0; i < size; ++i) bits |= (unsigned char)data[i];
+  return bits < 0x80;
+}
+
+void ByteCharStream::consume() {
+  if (Pos >= Size) throw antlr4::IllegalStateException("cannot consume EOF");
+  ++Pos;
+}
+
+// LA(1) is the current character, LA(-1) the previous one
+std::size_t ByteCharStream::LA(ssize_t i) {
+  if (i == 0) return 0;
+  ssize_t k = (ssize_t)Pos + (i > 0 ? i - 1 : i);
+  if (k < 0 or k >= (ssize_t)Size) return antlr4::IntStream::EOF;
+  return (unsigned char)Data[k];
+}
+
+// the whole buffer is always available, so marks are not needed
+ssize_t ByteCharStream::mark() {
+  return -1;
+}
+
+void ByteCharStream::release(ssize_t marker) {
+}
+
+std::size_t ByteCharStream::index() {
+  return Pos;
+}
+
+void ByteCharStream::seek(std::size_t index) {
+  Pos = index < Size ? index : Size;
+}
+
+std::size_t ByteCharStream::size() {
+  return Size;
+}
+
+std::string ByteCharStream::getSourceName() const {
+  return Name;
+}
+
+std::string ByteCharStream::getText(const antlr4::misc::Interval & interval) {
+  ssize_t start = interval.a, stop = interval.b;
+  if (stop >= (ssize_t)Size) stop = (ssize_t)Size - 1;
+  if (start < 0 or start > stop) return "";
+  return std::string(Data + start, stop - start + 1);
+}
+
+std::string ByteCharStream::toString() const {
+  return std::string(Data, Size);
+}
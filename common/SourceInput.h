@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    SourceInput - Reading Asl programs without copying them:
+//                  files mapped in memory and a character stream
+//                  for the lexer over their bytes
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "antlr4-runtime.h"
+
+#include <string>
+#include <cstddef>
+
+
+//////////////////////////////////////////////////////////////////////
+// Class MappedFile: the contents of a file mapped (read only) in
+// memory. The file is opened only once, and it is unmapped when the
+// object is destroyed.
+
+class MappedFile {
+
+public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile & operator=(const MappedFile &) = delete;
+
+  // Map the file. Returns false if it can not be opened or mapped,
+  // with the reason in getError (and notFound() if it does not exist)
+  bool open (const std::string & path);
+
+  const char *        getData  () const;
+  std::size_t         getSize  () const;
+  const std::string & getError () const;
+  bool                notFound () const;
+
+private:
+  const char * Data = "";
+  std::size_t  Size = 0;
+  bool         Mapped = false;
+  bool         NotFound = false;
+  std::string  Error;
+
+};  // class MappedFile
+
+
+//////////////////////////////////////////////////////////////////////
+// Class ByteCharStream: an antlr4 CharStream that reads the
+// characters directly from a buffer of bytes, which is kept by the
+// caller (and must live as long as the tokens). Each byte is a
+// character, so it is only equivalent to ANTLRInputStream (that
+// decodes UTF-8 into a copy of 32-bit code points) for ASCII text:
+// see isAscii.
+
+class ByteCharStream : public antlr4::CharStream {
+
+public:
+  ByteCharStream(const char *data, std::size_t size,
+                 const std::string & name = antlr4::IntStream::UNKNOWN_SOURCE_NAME);
+
+  // true if all the bytes of the buffer are ASCII characters
+  static bool isAscii (const char *data, std::size_t size);
+
+  // antlr4::IntStream
+  void        consume       () override;
+  std::size_t LA            (ssize_t i) override;
+  ssize_t     mark          () override;
+  void        release       (ssize_t marker) override;
+  std::size_t index         () override;
+  void        seek          (std::size_t index) override;
+  std::size_t size          () override;
+  std::string getSourceName () const override;
+
+  // antlr4::CharStream
+  std::string getText  (const antlr4::misc::Interval & interval) override;
+  std::string toString () const override;
+
+private:
+  const char * Data;
+  std::size_t  Size;
+  std::size_t  Pos = 0;
+  std::string  Name;
+
+};  // class ByteCharStream
@@ -98,6 +98,29 @@ int SymTable::findInStack(const std::string & ident) const {
   return -1;
 }
 
+// Returns the SymbolId (scope and slot) of ident, looking for it
+// from the top to the bottom of the stack. If ident is not found
+// the returned SymbolId has scope NoScope.
+SymTable::SymbolId SymTable::resolve(const std::string & ident) const {
+  return resolve(ident, ScopeIdsStack);
+}
+
+SymTable::SymbolId SymTable::resolve(const std::string & ident,
+                                     const std::vector<ScopeId> & scopes) const {
+  assert(not scopes.empty());
+  SymbolId sym;
+  for (int i = scopes.size() - 1; i >= 0; --i) {
+    ScopeId sc = scopes[i];
+    assert(sc < ScopesVec.size());
+    if (ScopesVec[sc].findSymbol(ident)) {
+      sym.scope = sc;
+      sym.slot  = ScopesVec[sc].getSlot(ident);
+      break;
+    }
+  }
+  return sym;
+}
+
 // Adds a new symbol in the current scope.
 void SymTable::addLocalVar(const std::string & ident, TypesMgr::TypeId type) {
   assert(not ScopeIdsStack.empty());
@@ -121,48 +144,45 @@ void SymTable::addFunction(const std::string & ident, TypesMgr::TypeId type) {
 
 // Check the class of a symbol. If not found return false
 bool SymTable::isLocalVarClass(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].isLocalVarClass(ident);
-  }
-  return false;
+  return isLocalVarClass(resolve(ident));
 }
 
 bool SymTable::isParameterClass(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].isParameterClass(ident);
-  }
-  return false;
+  return isParameterClass(resolve(ident));
 }
 
 bool SymTable::isFunctionClass(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].isFunctionClass(ident);
-  }
-  return false;
+  return isFunctionClass(resolve(ident));
 }
 
 // Get the TypeId of a symbol. If not found return type 'error'
 TypesMgr::TypeId SymTable::getType(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].getType(ident);
-  }
-  return Types.createErrorTy();
+  return getType(resolve(ident));
+}
+
+// Same accessors for an already resolved symbol
+bool SymTable::isLocalVarClass(SymbolId sym) const {
+  if (not sym.found()) return false;
+  assert(sym.scope < ScopesVec.size());
+  return ScopesVec[sym.scope].isLocalVarClass(sym.slot);
+}
+
+bool SymTable::isParameterClass(SymbolId sym) const {
+  if (not sym.found()) return false;
+  assert(sym.scope < ScopesVec.size());
+  return ScopesVec[sym.scope].isParameterClass(sym.slot);
+}
+
+bool SymTable::isFunctionClass(SymbolId sym) const {
+  if (not sym.found()) return false;
+  assert(sym.scope < ScopesVec.size());
+  return ScopesVec[sym.scope].isFunctionClass(sym.slot);
+}
+
+TypesMgr::TypeId SymTable::getType(SymbolId sym) const {
+  if (not sym.found()) return Types.createErrorTy();
+  assert(sym.scope < ScopesVec.size());
+  return ScopesVec[sym.scope].getType(sym.slot);
 }
 
 // Accessor/Mutator to the attribute currFunctionType
@@ -209,6 +229,17 @@ bool SymTable::noMainProperlyDeclared() const {
   return true;
 }
 
+std::size_t SymTable::getNumberOfScopes() const {
+  return ScopesVec.size();
+}
+
+std::size_t SymTable::getNumberOfSymbols() const {
+  std::size_t n = 0;
+  for (auto const & scope : ScopesVec)
+    n += scope.getNumberOfSymbols();
+  return n;
+}
+
 
 // class SymTable::ScopeInfo ==============================================================
 
@@ -224,17 +255,20 @@ std::string SymTable::ScopeInfo::getName() const {
 // Mutators to add symbols to the scope
 void SymTable::ScopeInfo::addLocalVar(const std::string & ident, TypesMgr::TypeId type) {
   assert(SymbolsMap.find(ident) == SymbolsMap.end());
-  SymbolsMap[ident] = SymbolInfo::createLocalVar(type);
+  SymbolsMap[ident] = SymbolsVec.size();
+  SymbolsVec.push_back(SymbolInfo::createLocalVar(type));
   IdentsList.push_back(ident);
 }
 void SymTable::ScopeInfo::addParameter(const std::string & ident, TypesMgr::TypeId type) {
   assert(SymbolsMap.find(ident) == SymbolsMap.end());
-  SymbolsMap[ident] = SymbolInfo::createParameter(type);
+  SymbolsMap[ident] = SymbolsVec.size();
+  SymbolsVec.push_back(SymbolInfo::createParameter(type));
   IdentsList.push_back(ident);
 }
 void SymTable::ScopeInfo::addFunction(const std::string & ident, TypesMgr::TypeId type) {
   assert(SymbolsMap.find(ident) == SymbolsMap.end());
-  SymbolsMap[ident] = SymbolInfo::createFunction(type);
+  SymbolsMap[ident] = SymbolsVec.size();
+  SymbolsVec.push_back(SymbolInfo::createFunction(type));
   IdentsList.push_back(ident);
 }
 
@@ -243,41 +277,69 @@ bool SymTable::ScopeInfo::findSymbol(const std::string & ident) const {
   return (SymbolsMap.find(ident) != SymbolsMap.end());
 }
 
+// Accessor to get the slot of a symbol. The symbol MUST exist.
+std::size_t SymTable::ScopeInfo::getSlot(const std::string & ident) const {
+  auto const & it = SymbolsMap.find(ident);
+  assert(it != SymbolsMap.end());
+  return it->second;
+}
+
+// Number of symbols declared in the scope
+std::size_t SymTable::ScopeInfo::getNumberOfSymbols() const {
+  return SymbolsVec.size();
+}
+
 // Accessors to check the class of the symbol. If not found return false
 bool SymTable::ScopeInfo::isLocalVarClass(const std::string & ident) const {
   auto const & it = SymbolsMap.find(ident);
   if (it == SymbolsMap.end())
     return false;
-  return it->second.isLocalVarClass();
+  return SymbolsVec[it->second].isLocalVarClass();
 }
 bool SymTable::ScopeInfo::isParameterClass(const std::string & ident) const {
   auto const & it = SymbolsMap.find(ident);
   if (it == SymbolsMap.end())
     return false;
-  return it->second.isParameterClass();
+  return SymbolsVec[it->second].isParameterClass();
 }
 bool SymTable::ScopeInfo::isFunctionClass(const std::string & ident) const {
   auto const & it = SymbolsMap.find(ident);
   if (it == SymbolsMap.end())
     return false;
-  return it->second.isFunctionClass();
+  return SymbolsVec[it->second].isFunctionClass();
 }
 
 // Accessor to get the TypeId of a symbol. The symbol MUST exist.
 TypesMgr::TypeId SymTable::ScopeInfo::getType(const std::string & ident) const {
-  assert(SymbolsMap.find(ident) != SymbolsMap.end());
-  auto const & it = SymbolsMap.find(ident);
-  return it->second.getType();
+  return getType(getSlot(ident));
+}
+
+// Accessors to the symbol at a given slot. The slot MUST exist.
+bool SymTable::ScopeInfo::isLocalVarClass(std::size_t slot) const {
+  assert(slot < SymbolsVec.size());
+  return SymbolsVec[slot].isLocalVarClass();
+}
+bool SymTable::ScopeInfo::isParameterClass(std::size_t slot) const {
+  assert(slot < SymbolsVec.size());
+  return SymbolsVec[slot].isParameterClass();
+}
+bool SymTable::ScopeInfo::isFunctionClass(std::size_t slot) const {
+  assert(slot < SymbolsVec.size());
+  return SymbolsVec[slot].isFunctionClass();
+}
+TypesMgr::TypeId SymTable::ScopeInfo::getType(std::size_t slot) const {
+  assert(slot < SymbolsVec.size());
+  return SymbolsVec[slot].getType();
 }
 
 // Writes the contents of the scope to the standard output.
 void SymTable::ScopeInfo::print(TypesMgr & Types) const {
   std::cout << "---------------- scope name: " << name << std::endl;
-  for (auto & id : IdentsList) {
-    auto const & it = SymbolsMap.find(id);
-    std::cout << id << ":" << it->second.class2string();
-    if (not it->second.isErrorClass()) {
-      std::cout << "," << Types.to_string(it->second.getType());
+  for (std::size_t slot = 0; slot < IdentsList.size(); ++slot) {
+    const SymbolInfo & info = SymbolsVec[slot];
+    std::cout << IdentsList[slot] << ":" << info.class2string();
+    if (not info.isErrorClass()) {
+      std::cout << "," << Types.to_string(info.getType());
     }
     std::cout << std::endl;
   }
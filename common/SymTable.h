@@ -57,6 +57,10 @@
 // scopes that determines which symbols are visible and
 // which are not. Entering in a function will push a new
 // scope to the stack and exiting will pop the stack.
+// Inside a scope every symbol has a slot (its position in
+// declaration order). Once an identifier has been resolved,
+// the pair (scope, slot) identifies its symbol without any
+// further lookup by name.
 
 class SymTable {
 
@@ -64,6 +68,15 @@ public:
 
   // The ScopeId is an index in a vector
   typedef std::size_t ScopeId;
+  static const ScopeId NoScope = ScopeId(-1);
+
+  // The SymbolId of a resolved identifier: the scope where it is
+  // declared and its slot in this scope (NoScope if not declared)
+  struct SymbolId {
+    ScopeId     scope = NoScope;
+    std::size_t slot  = 0;
+    bool found () const { return scope != NoScope; }
+  };
 
   // Constructor
   SymTable(TypesMgr & Types);
@@ -86,6 +99,14 @@ public:
   //   - in the whole stack. Returns the number of scopes skipped to
                           // find the symbol, or -1 if it is not found
   int     findInStack        (const std::string & ident)             const;
+  //   - in the whole stack, returning the SymbolId of the symbol
+  //     (not found() if it is not declared)
+  SymbolId resolve           (const std::string & ident)             const;
+  //   - the same, but in a given stack of scopes instead of the
+  //     current one (this allows several visitors, each one with its
+  //     own stack, to resolve identifiers at the same time)
+  SymbolId resolve           (const std::string & ident,
+                              const std::vector<ScopeId> & scopes)   const;
 
   // Adds a new symbol in the current scope
   void addLocalVar  (const std::string & ident, TypesMgr::TypeId type);
@@ -100,6 +121,13 @@ public:
   // Accessor to get the TypeId of a symbol. If not found return type 'error'
   TypesMgr::TypeId getType (const std::string & ident) const;
 
+  // The same accessors for an already resolved symbol (they do
+  // not depend on the current stack of scopes)
+  bool isLocalVarClass  (SymbolId sym) const;
+  bool isParameterClass (SymbolId sym) const;
+  bool isFunctionClass  (SymbolId sym) const;
+  TypesMgr::TypeId getType (SymbolId sym) const;
+
   // Accessor/Mutator to the type (TypeId) of the current function
   TypesMgr::TypeId getCurrentFunctionTy ()                      const;
   void             setCurrentFunctionTy (TypesMgr::TypeId type);
@@ -107,6 +135,10 @@ public:
   // Check the existence of the "main" function
   bool noMainProperlyDeclared() const;
 
+  // Number of scopes, and of symbols declared in all of them
+  std::size_t getNumberOfScopes  () const;
+  std::size_t getNumberOfSymbols () const;
+
   // Print the symbols of a scope on the standard output
   //   - the symbols of the current scope (top of the stack)
   void printCurrentScope () const;
@@ -146,6 +178,10 @@ private:
 
     // Accessor to check the existence of a symbol
     bool findSymbol (const std::string & ident) const;
+    // Accessor to get the slot of a symbol. The symbol MUST exist
+    std::size_t getSlot (const std::string & ident) const;
+    // Number of symbols declared in the scope
+    std::size_t getNumberOfSymbols () const;
 
     // Accessors to check the class of the symbol. If not found return false
     bool isLocalVarClass  (const std::string & ident) const;
@@ -155,6 +191,12 @@ private:
     // Accessor to get the TypeId of a symbol. The symbol MUST exist
     TypesMgr::TypeId getType (const std::string & ident) const;
 
+    // Accessors to the symbol at a given slot. The slot MUST exist
+    bool isLocalVarClass  (std::size_t slot) const;
+    bool isParameterClass (std::size_t slot) const;
+    bool isFunctionClass  (std::size_t slot) const;
+    TypesMgr::TypeId getType (std::size_t slot) const;
+
     // Writes the contents of the scope to the standard output
     void print (TypesMgr & Types) const;
 
@@ -165,10 +207,12 @@ private:
 
     // For the name of the scope
     std::string name;
-    // The information associated to each identifier declared in this scope.
-    std::map<std::string, SymbolInfo> SymbolsMap;
+    // The slot of each identifier declared in this scope.
+    std::map<std::string, std::size_t> SymbolsMap;
     // For remember the order in which the Ids where introduced.
     std::vector<std::string> IdentsList;
+    // The information associated to each slot (same order as IdentsList).
+    std::vector<SymbolInfo> SymbolsVec;
 
 
     //////////////////////////////////////////////////////////////////
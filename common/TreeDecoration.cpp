@@ -35,30 +35,71 @@
 #include "antlr4-runtime.h"
 
 #include <string>
+#include <vector>
+#include <cassert>
 
 
+// Numbering of the nodes:
+void TreeDecoration::indexTree(antlr4::tree::ParseTree *tree) {
+  std::size_t n = 0;
+  // iterative preorder traversal (expressions may be deeply nested)
+  std::vector<antlr4::tree::ParseTree *> pending;
+  if (tree) pending.push_back(tree);
+  while (not pending.empty()) {
+    antlr4::tree::ParseTree *node = pending.back();
+    pending.pop_back();
+    DecoratedRuleContext *ctx = dynamic_cast<DecoratedRuleContext *>(node);
+    if (not ctx) continue;   // terminal nodes are not decorated
+    ctx->nodeIndex = n++;
+    for (auto it = node->children.rbegin(); it != node->children.rend(); ++it)
+      pending.push_back(*it);
+  }
+  ScopeDecor.assign(n, 0);
+  TypeDecor.assign(n, 0);
+  IsLValueDecor.assign(n, 0);
+  SymbolDecor.assign(n, SymTable::SymbolId());
+}
+
+std::size_t TreeDecoration::getNumberOfNodes() const {
+  return TypeDecor.size();
+}
+
+std::size_t TreeDecoration::index(antlr4::ParserRuleContext *ctx) {
+  std::size_t i = static_cast<DecoratedRuleContext *>(ctx)->nodeIndex;
+  assert(i != DecoratedRuleContext::NO_INDEX and "indexTree was not called");
+  return i;
+}
+
 // Getters:
 SymTable::ScopeId TreeDecoration::getScope(antlr4::ParserRuleContext *ctx) {
-  return ScopeDecor.get(ctx);
+  return ScopeDecor[index(ctx)];
 }
 
 TypesMgr::TypeId TreeDecoration::getType(antlr4::ParserRuleContext *ctx) {
-  return TypeDecor.get(ctx);
+  return TypeDecor[index(ctx)];
 }
 
 bool TreeDecoration::getIsLValue(antlr4::ParserRuleContext *ctx) {
-  return IsLValueDecor.get(ctx);
+  return IsLValueDecor[index(ctx)];
+}
+
+SymTable::SymbolId TreeDecoration::getSymbol(antlr4::ParserRuleContext *ctx) {
+  return SymbolDecor[index(ctx)];
 }
 
 // Setters:
 void TreeDecoration::putScope(antlr4::ParserRuleContext *ctx, SymTable::ScopeId s) {
-  ScopeDecor.put(ctx, s);
+  ScopeDecor[index(ctx)] = s;
 }
 
 void TreeDecoration::putType(antlr4::ParserRuleContext *ctx, TypesMgr::TypeId t) {
-  TypeDecor.put(ctx, t);
+  TypeDecor[index(ctx)] = t;
 }
 
 void TreeDecoration::putIsLValue(antlr4::ParserRuleContext *ctx, bool b) {
-  IsLValueDecor.put(ctx, b);
+  IsLValueDecor[index(ctx)] = b;
+}
+
+void TreeDecoration::putSymbol(antlr4::ParserRuleContext *ctx, SymTable::SymbolId sym) {
+  SymbolDecor[index(ctx)] = sym;
 }
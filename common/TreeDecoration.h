@@ -33,21 +33,49 @@
 #include "SymTable.h"
 
 #include "antlr4-runtime.h"
-#include "tree/ParseTreeProperty.h"
+
+#include <vector>
+#include <cstddef>
 
 // using namespace std;
 
 
+//////////////////////////////////////////////////////////////////////
+// Class DecoratedRuleContext: base class of all the contexts
+// (nodes) of the parse tree (see contextSuperClass in Asl.g4).
+// It only adds the dense index of the node, assigned by
+// TreeDecoration::indexTree, that TreeDecoration uses to locate
+// the attributes of the node.
+
+class DecoratedRuleContext : public antlr4::ParserRuleContext {
+
+public:
+  using antlr4::ParserRuleContext::ParserRuleContext;
+  DecoratedRuleContext() = default;
+
+  // Index of the node (NO_INDEX until indexTree is called)
+  static const std::size_t NO_INDEX = std::size_t(-1);
+  std::size_t nodeIndex = NO_INDEX;
+
+};  // class DecoratedRuleContext
+
+
 //////////////////////////////////////////////////////////////////////
 // Class TreeDecoration: the nodes of the parser tree generated
 // by the antlr4 parser, whose base type is
 // antlr4::ParserRuleContext *, can have different attributes.
-// TreeDecoration groups all of them, and uses different
-// ParseTreeProperty to save this information.
-// Currently three kinds of attributes may be present:
+// TreeDecoration groups all of them. Before the visitors run,
+// indexTree numbers the nodes 0..N-1 and every attribute is
+// stored in a vector of size N indexed by that number, so
+// getting or setting an attribute is just an array access.
+// The vectors never grow after indexTree, so different threads can
+// set the attributes of different nodes at the same time.
+// Currently four kinds of attributes may be present:
 //   - scope, for nodes like the program, or functions
 //   - type, for expressions or type especification
 //   - isLValue, for expressions
+//   - symbol, for identifiers (and the expressions that are
+//     just an identifier): the resolved SymbolId
 // Different visitors set and access these attributes:
 //   - SymbolsVisitor     [TypeCheck phase 1]
 //       * set and access the scope attribute
@@ -56,28 +84,47 @@
 //       * access the scope attribute
 //       * set and access the type attribute (in expressions)
 //       * set and access the isLValue attribute (in expressions)
+//       * set and access the symbol attribute (in identifiers)
 //   - CodeGenVisitor     [Code Generation]
 //       * access the scope attribute
 //       * access the type attribute
+//       * access the symbol attribute
 
 class TreeDecoration {
 
 public:
   TreeDecoration() = default;
 
+  // Assign a dense index to every node of the tree (preorder)
+  // and allocate the attributes for all of them. Must be called
+  // once, on the whole tree, before any get/put.
+  void indexTree (antlr4::tree::ParseTree *tree);
+  // Number of indexed nodes
+  std::size_t getNumberOfNodes () const;
+
   // Getters:
   SymTable::ScopeId getScope    (antlr4::ParserRuleContext *ctx);
   TypesMgr::TypeId  getType     (antlr4::ParserRuleContext *ctx);
   bool              getIsLValue (antlr4::ParserRuleContext *ctx);
+  SymTable::SymbolId getSymbol  (antlr4::ParserRuleContext *ctx);
 
   // Setters:
   void putScope    (antlr4::ParserRuleContext *ctx, SymTable::ScopeId s);
   void putType     (antlr4::ParserRuleContext *ctx, TypesMgr::TypeId t);
   void putIsLValue (antlr4::ParserRuleContext *ctx, bool b);
+  void putSymbol   (antlr4::ParserRuleContext *ctx, SymTable::SymbolId sym);
 
 private:
-  antlr4::tree::ParseTreeProperty<SymTable::ScopeId> ScopeDecor;
-  antlr4::tree::ParseTreeProperty<TypesMgr::TypeId>  TypeDecor;
-  antlr4::tree::ParseTreeProperty<bool>              IsLValueDecor;
+  // index of an already indexed node
+  static std::size_t index (antlr4::ParserRuleContext *ctx);
+
+  // One vector per attribute, indexed by the node index. Unset
+  // attributes are 0 (false for isLValue, not found() for symbol).
+  // IsLValue uses char instead of vector<bool>, so that different
+  // nodes can be set concurrently.
+  std::vector<SymTable::ScopeId> ScopeDecor;
+  std::vector<TypesMgr::TypeId>  TypeDecor;
+  std::vector<char>              IsLValueDecor;
+  std::vector<SymTable::SymbolId> SymbolDecor;
 
 };  // class TreeDecoration
@@ -30,6 +30,8 @@
 #include "TypesMgr.h"
 
 #include <vector>
+#include <map>
+#include <utility>
 #include <string>
 #include <iostream>
 
@@ -85,16 +87,31 @@ TypesMgr::TypeId TypesMgr::createVoidTy() {
   return VoidTyId;
 }
 
+// compound types are created only the first time; later requests
+// for a structurally equal type get the TypeId of the existing one
+// (the subtypes are already unique, so comparing TypeId's suffices)
 TypesMgr::TypeId TypesMgr::createFunctionTy(const std::vector<TypeId> & paramsTypes,
 					    TypeId returnType) {
+  auto key = std::make_pair(paramsTypes, returnType);
+  auto it = FunctionTypesIdx.find(key);
+  if (it != FunctionTypesIdx.end())
+    return it->second;
   TypesVec.push_back(Type(paramsTypes, returnType));
-  return TypesVec.size()-1;
+  TypeId tid = TypesVec.size()-1;
+  FunctionTypesIdx.emplace(std::move(key), tid);
+  return tid;
 }
 
 TypesMgr::TypeId TypesMgr::createArrayTy(unsigned int size,
 					 TypeId elemType) {
+  auto key = std::make_pair(size, elemType);
+  auto it = ArrayTypesIdx.find(key);
+  if (it != ArrayTypesIdx.end())
+    return it->second;
   TypesVec.push_back(Type{size, elemType});
-  return TypesVec.size()-1;
+  TypeId tid = TypesVec.size()-1;
+  ArrayTypesIdx.emplace(key, tid);
+  return tid;
 }
 
 // ----------------------------------------------------------------------
@@ -201,38 +218,9 @@ TypesMgr::TypeId TypesMgr::getArrayElemType(TypeId tid) const {
 // methods for checking different compatibilities of Types
 
 bool TypesMgr::equalTypes(TypeId tid1, TypeId tid2) const {
-  if (tid1 == tid2)
-    return true;
-  const Type & t1 = TypesVec.at(tid1);
-  const Type & t2 = TypesVec.at(tid2);
-  if (t1.getTypeKind() != t2.getTypeKind())
-    return false;
-  if (t1.isPrimitiveTy() and t2.isPrimitiveTy())
-    return true;
-  if (t1.isFunctionTy()) {  // or: if (t2.isFunctionTy()) {
-    if (t1.getNumOfParameters() != t2.getNumOfParameters())
-      return false;
-    TypeId tid1_aux;
-    TypeId tid2_aux;
-    for (unsigned int i = 0; i < t1.getNumOfParameters(); ++i) {
-      tid1_aux = t1.getParameterType(i);
-      tid2_aux = t2.getParameterType(i);
-      if (not equalTypes(tid1_aux, tid2_aux))
-	return false;
-    }
-    tid1_aux = t1.getFuncReturnType();
-    tid2_aux = t2.getFuncReturnType();
-    return equalTypes(tid1_aux, tid2_aux);
-  }
-  if (t1.isArrayTy()) {  // or: if (t2.isArrayTy()) {
-    if (t1.getArraySize() != t2.getArraySize()) {
-      return false;
-    }
-    TypeId tid1_aux = t1.getArrayElemType();
-    TypeId tid2_aux = t2.getArrayElemType();
-    return equalTypes(tid1_aux, tid2_aux);
-  }
-  return false;
+  // types are hash-consed (see createFunctionTy and createArrayTy),
+  // so structurally equal types have the same TypeId
+  return tid1 == tid2;
 }
 
 bool TypesMgr::comparableTypes(TypeId tid1, TypeId tid2,
@@ -270,6 +258,12 @@ std::size_t TypesMgr::getSizeOfType (TypeId tid) const {
   return 0;
 }
 
+// ----------------------------------------------------------------------
+// number of different types created
+std::size_t TypesMgr::getNumberOfTypes () const {
+  return TypesVec.size();
+}
+
 // ----------------------------------------------------------------------
 // methods to convert to string and print types
 
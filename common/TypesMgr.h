@@ -29,6 +29,8 @@
 #pragma once
 
 #include <vector>
+#include <map>
+#include <utility>
 #include <string>
 #include <iostream>
 
@@ -46,6 +48,12 @@
 // integer, float, boolean, character and void. Also it
 // recognizes two compound types: functions and fixed-size
 // arrays. Finally there exist a special type 'error'.
+// Types are hash-consed: creating a type structurally equal to
+// an existing one returns the TypeId of the existing type, so
+// two types are equal iff their TypeId's are equal.
+// The const methods can be called from several threads at the same
+// time, as long as no type is being created (compound types are all
+// created by the SymbolsVisitor, before the type check).
 
 class TypesMgr {
 
@@ -97,7 +105,7 @@ public:
   TypeId       getArrayElemType (TypeId tid) const;
 
   // Methods to check different compatibilities of types
-  //   - structurally equal?
+  //   - structurally equal? (same TypeId, as types are unique)
   bool equalTypes      (TypeId tid1, TypeId tid2)     const;
   //   - comparable with the relational operator op?
   bool comparableTypes (TypeId tid1, TypeId tid2,
@@ -108,6 +116,9 @@ public:
   // Method to compute the size of a type (primitive type size = 1)
   std::size_t getSizeOfType (TypeId tid) const;
 
+  // Number of different types created (primitive types included)
+  std::size_t getNumberOfTypes () const;
+
   // Methods to convert to string and print types
   std::string to_string (TypeId         tid)            const;
   void        dump      (TypeId         tid,
@@ -121,6 +132,10 @@ private:
   // Attributes:
   //   - vector to save the Types
   std::vector<Type> TypesVec;
+  //   - indexes of the compound types already created, used to
+  //     return the same TypeId for structurally equal types
+  std::map<std::pair<std::vector<TypeId>, TypeId>, TypeId> FunctionTypesIdx;
+  std::map<std::pair<unsigned int, TypeId>, TypeId>        ArrayTypesIdx;
 
   // There are eight kinds of types:
   //   - an especial kind error,
@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    WorkPool - Pool of threads that run independent tasks,
+//               balancing the load by work stealing
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "WorkPool.h"
+#include "PhaseStats.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <exception>
+
+// using namespace std;
+
+
+namespace {
+
+  // queue of pending tasks of one worker
+  struct TaskQueue {
+    std::mutex              lock;
+    std::deque<std::size_t> tasks;
+  };
+
+  // take a task: first from the front of the own queue, then from the
+  // back of the other ones. Tasks are never added while running, so
+  // when all the queues are empty the worker is done
+  bool nextTask(std::vector<TaskQueue> & queues, unsigned self, std::size_t & t) {
+    for (unsigned k = 0; k < queues.size(); ++k) {
+      TaskQueue & q = queues[(self + k) % queues.size()];
+      std::lock_guard<std::mutex> guard(q.lock);
+      if (q.tasks.empty()) continue;
+      if (k == 0) {
+        t = q.tasks.front();
+        q.tasks.pop_front();
+      }
+      else {
+        t = q.tasks.back();
+        q.tasks.pop_back();
+      }
+      return true;
+    }
+    return false;
+  }
+
+}  // namespace
+
+
+WorkPool::WorkPool(unsigned nthreads) : NumThreads(nthreads) {
+  if (NumThreads == 0) NumThreads = std::thread::hardware_concurrency();
+  if (NumThreads == 0) NumThreads = 1;
+}
+
+unsigned WorkPool::getNumberOfThreads() const {
+  return NumThreads;
+}
+
+void WorkPool::run(std::size_t ntasks, const std::function<void(std::size_t)> & task) {
+  unsigned nworkers = NumThreads;
+  if (ntasks < nworkers) nworkers = ntasks;
+  if (nworkers <= 1) {
+    for (std::size_t t = 0; t < ntasks; ++t) task(t);
+    return;
+  }
+
+  std::vector<TaskQueue> queues(nworkers);
+  for (std::size_t t = 0; t < ntasks; ++t)
+    queues[t % nworkers].tasks.push_back(t);
+
+  std::mutex errorLock;
+  std::exception_ptr error;
+  auto worker = [&](unsigned self) {
+    std::size_t t;
+    while (nextTask(queues, self, t)) {
+      try {
+        task(t);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> guard(errorLock);
+        if (not error) error = std::current_exception();
+      }
+    }
+  };
+
+  // the allocations of the other workers are added to this thread
+  std::atomic<std::size_t> allocations(0);
+  std::vector<std::thread> threads;
+  for (unsigned w = 1; w < nworkers; ++w)
+    threads.emplace_back([&, w] {
+      std::size_t start = PhaseStats::getAllocations();
+      worker(w);
+      allocations += PhaseStats::getAllocations() - start;
+    });
+  worker(0);
+  for (auto & th : threads) th.join();
+  PhaseStats::addAllocations(allocations);
+  if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    WorkPool - Pool of threads that run independent tasks,
+//               balancing the load by work stealing
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+#include <cstddef>
+
+
+//////////////////////////////////////////////////////////////////////
+// Class WorkPool: runs a set of independent tasks, numbered from 0,
+// on several threads. Every worker has its own queue of tasks: it
+// takes them from the front of its queue and, when it is empty, it
+// steals tasks from the back of the queues of the other workers.
+//
+// The tasks are dealt out to the queues in round robin, so if they
+// are ordered from the most to the least expensive every worker
+// starts with the big ones and the small ones fill the gaps at the end.
+
+class WorkPool {
+
+public:
+  // Constructor: nthreads workers (0 means one per hardware thread)
+  explicit WorkPool(unsigned nthreads = 0);
+
+  // Number of workers of the pool
+  unsigned getNumberOfThreads () const;
+
+  // Run task(0), ..., task(ntasks-1) and wait until all of them have
+  // finished. The calling thread is one of the workers. If some task
+  // throws an exception the other tasks are still run, and the first
+  // exception is thrown again at the end. The memory allocations of the
+  // other workers are counted in the calling thread (see PhaseStats)
+  void run (std::size_t ntasks, const std::function<void(std::size_t)> & task);
+
+private:
+  unsigned NumThreads;
+
+};  // class WorkPool
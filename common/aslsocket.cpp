@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    aslsocket - Local socket and message framing shared by the
+//                compiler server (asl --server) and its client
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "aslsocket.h"
+
+#include <cstdint>
+#include <cstdlib>    // getenv
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+using namespace std;
+
+
+static bool writeAll(int fd, const char *p, size_t n) {
+  while (n > 0) {
+    // MSG_NOSIGNAL: a client that goes away must not kill the server
+    ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+    if (w < 0 and errno == EINTR) continue;
+    if (w <= 0) return false;
+    p += w;
+    n -= w;
+  }
+  return true;
+}
+
+static bool readAll(int fd, char *p, size_t n) {
+  while (n > 0) {
+    ssize_t r = recv(fd, p, n, 0);
+    if (r < 0 and errno == EINTR) continue;
+    if (r <= 0) return false;
+    p += r;
+    n -= r;
+  }
+  return true;
+}
+
+bool write_frame(int fd, const string &data) {
+  if (data.size() > MAX_FRAME_SIZE) return false;
+  uint32_t len = data.size();
+  return writeAll(fd, (const char *)&len, sizeof(len)) and
+         writeAll(fd, data.data(), data.size());
+}
+
+bool read_frame(int fd, string &data) {
+  uint32_t len;
+  if (not readAll(fd, (char *)&len, sizeof(len)) or len > MAX_FRAME_SIZE) return false;
+  data.resize(len);
+  return len == 0 or readAll(fd, &data[0], len);
+}
+
+string join_options(const vector<string> &options) {
+  string data;
+  for (auto &o : options) {
+    data += o;
+    data += '\0';
+  }
+  return data;
+}
+
+vector<string> split_options(const string &data) {
+  vector<string> options;
+  size_t start = 0;
+  for (size_t i = 0; i < data.size(); ++i)
+    if (data[i] == '\0') {
+      options.push_back(data.substr(start, i - start));
+      start = i + 1;
+    }
+  return options;
+}
+
+string default_socket_path() {
+  const char *env = getenv("ASL_SOCKET");
+  if (env and *env) return env;
+  return "/tmp/asl-" + to_string(getuid()) + ".sock";
+}
+
+// fill the address of the socket 'path'
+static bool socketAddress(const string &path, sockaddr_un &addr, string &error) {
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.empty() or path.size() >= sizeof(addr.sun_path)) {
+    error = "Invalid socket path: " + path;
+    return false;
+  }
+  memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+int connect_unix(const string &path, string &error) {
+  sockaddr_un addr;
+  if (not socketAddress(path, addr, error)) return -1;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    error = string("Can not create a socket: ") + strerror(errno);
+    return -1;
+  }
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    error = "No server listening on " + path + ": " + strerror(errno);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int listen_unix(const string &path, string &error) {
+  sockaddr_un addr;
+  if (not socketAddress(path, addr, error)) return -1;
+  string ignored;
+  int other = connect_unix(path, ignored);
+  if (other >= 0) {
+    close(other);
+    error = "A server is already listening on " + path;
+    return -1;
+  }
+  unlink(path.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    error = string("Can not create a socket: ") + strerror(errno);
+    return -1;
+  }
+  // only the owner may connect (the socket is created with umask
+  // permissions, so they are restricted before binding)
+  mode_t old = umask(0077);
+  int bound = bind(fd, (sockaddr *)&addr, sizeof(addr));
+  umask(old);
+  if (bound != 0 or listen(fd, 64) != 0) {
+    error = "Can not listen on " + path + ": " + strerror(errno);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
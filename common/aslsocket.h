@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    aslsocket - Local socket and message framing shared by the
+//                compiler server (asl --server) and its client
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+//////////////////////////////////////////////////////////////////////
+// Protocol of the compiler server. The client connects to a Unix
+// socket and sends one request; the server answers it and closes
+// the connection. Every message is a sequence of frames, and each
+// frame is its length (32 bits, in the byte order of the machine:
+// both ends run in the same one) followed by that many bytes.
+//
+//   request:  command ("compile" or "shutdown")
+//             options (the asl options, each one ended by '\0')
+//             source  (the Asl program)
+//   answer:   status  (exit status of asl, in decimal)
+//             output  (what asl writes on std::cout)
+//             errors  (what asl writes on std::cerr)
+
+// largest frame accepted
+const unsigned MAX_FRAME_SIZE = 1u << 30;
+
+// write/read one frame. They return false if the connection failed
+// (or the frame is too large)
+bool write_frame(int fd, const std::string & data);
+bool read_frame(int fd, std::string & data);
+
+// options <-> frame contents
+std::string join_options(const std::vector<std::string> & options);
+std::vector<std::string> split_options(const std::string & data);
+
+// socket used when none is given: $ASL_SOCKET, or one per user in /tmp
+std::string default_socket_path();
+
+// create the socket of a server and listen on it, removing a stale
+// socket file left by a previous server. Returns the file descriptor,
+// or -1 (with a message in 'error') if it fails or another server is
+// already listening
+int listen_unix(const std::string & path, std::string & error);
+
+// connect to a server. Returns the file descriptor, or -1 (with a
+// message in 'error') if there is no server listening
+int connect_unix(const std::string & path, std::string & error);
@@ -27,16 +27,158 @@
 ////////////////////////////////////////////////////////////////
 
 #include <iostream>
+#include <utility>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
 #include "code.h"
 
 using namespace std;
 
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'operandPool'
+
+// pool made current in this thread by an operandPool::scope
+static thread_local shared_ptr<operandPool> CurrentPool;
+
+// pool used when no other one is current
+static const shared_ptr<operandPool> & processPool() {
+  static const shared_ptr<operandPool> pool = make_shared<operandPool>();
+  return pool;
+}
+
+// chunk (and position in it) of the string at position pos: chunk k
+// starts at position 2^FIRST_CHUNK_BITS * (2^k - 1)
+static inline void chunkOf(uint32_t pos, unsigned firstBits, unsigned &k, uint32_t &offset) {
+  uint32_t p = pos + (uint32_t(1) << firstBits);
+  unsigned top = 31 - __builtin_clz(p);
+  k = top - firstBits;
+  offset = p - (uint32_t(1) << top);
+}
+
+operandPool::operandPool() : numNames(0) {
+  for (auto & c : chunks) c.store(nullptr, memory_order_relaxed);
+}
+
+operandPool::~operandPool() {
+  for (auto & c : chunks) delete [] c.load(memory_order_relaxed);
+}
+
+uint32_t operandPool::intern(const string &s) {
+  lock_guard<mutex> lock(indexMutex);
+  auto it = index.find(s);
+  if (it != index.end()) return it->second;
+
+  uint32_t pos = numNames;
+  if (pos > operand::MAX_VALUE) throw length_error("too many different operands");
+  unsigned k;
+  uint32_t offset;
+  chunkOf(pos, FIRST_CHUNK_BITS, k, offset);
+  string *chunk = chunks[k].load(memory_order_relaxed);
+  if (not chunk) {
+    chunk = new string[size_t(1) << (FIRST_CHUNK_BITS + k)];
+    chunks[k].store(chunk, memory_order_release);
+  }
+  chunk[offset] = s;
+  ++numNames;
+  index.insert(make_pair(s, pos));
+  return pos;
+}
+
+const string & operandPool::name(uint32_t pos) const {
+  unsigned k;
+  uint32_t offset;
+  chunkOf(pos, FIRST_CHUNK_BITS, k, offset);
+  return chunks[k].load(memory_order_acquire)[offset];
+}
+
+operandPool & operandPool::current() {
+  operandPool *p = CurrentPool.get();
+  return p ? *p : *processPool();
+}
+
+shared_ptr<operandPool> operandPool::get_current() {
+  return CurrentPool ? CurrentPool : processPool();
+}
+
+operandPool::scope::scope(const shared_ptr<operandPool> &p) : previous(std::move(CurrentPool)) {
+  CurrentPool = p;
+}
+
+operandPool::scope::~scope() {
+  CurrentPool = std::move(previous);
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'operand'
+
+// handle layout: 2 bits of kind + 30 bits of payload
+static const unsigned KIND_SHIFT = 30;
+static const uint32_t PAYLOAD_MASK = (uint32_t(1) << KIND_SHIFT) - 1;
+
+// if s is a canonical decimal number (no sign, no leading zeros) that
+// fits in the payload, store its value in n and return true
+static bool inlineNumber(const char *s, size_t len, uint32_t &n) {
+  if (len == 0 or len > 9) return false;   // 9 digits always fit in 30 bits
+  if (s[0] == '0' and len > 1) return false;
+  n = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (s[i] < '0' or s[i] > '9') return false;
+    n = n*10 + (s[i] - '0');
+  }
+  return true;
+}
+
+/// constructors
+operand::operand() : h(0) {}
+operand::operand(const char *s) : operand(string(s)) {}
+operand::operand(Kind k, uint32_t n) : h((uint32_t(k) << KIND_SHIFT) | (n & PAYLOAD_MASK)) {}
+operand::operand(const string &s) {
+  uint32_t n;
+  if (s.empty())
+    h = 0;
+  else if (s[0] == '%' and inlineNumber(s.c_str()+1, s.size()-1, n))
+    h = (uint32_t(_TEMP) << KIND_SHIFT) | n;
+  else if (inlineNumber(s.c_str(), s.size(), n))
+    h = (uint32_t(_INT) << KIND_SHIFT) | n;
+  else
+    h = (uint32_t(_NAME) << KIND_SHIFT) | operandPool::current().intern(s);
+}
+
+operand::Kind operand::kind() const { return Kind(h >> KIND_SHIFT); }
+bool operand::empty() const { return h == 0; }
+uint32_t operand::handle() const { return h; }
+uint32_t operand::value() const { return h & PAYLOAD_MASK; }
+bool operand::operator==(const operand &o) const { return h == o.h; }
+bool operand::operator!=(const operand &o) const { return h != o.h; }
+
+ostream & operator<<(ostream &os, const operand &o) {
+  switch (o.kind()) {
+  case operand::_TEMP : return os << '%' << o.value();
+  case operand::_INT  : return os << o.value();
+  case operand::_NAME : return os << operandPool::current().name(o.value());
+  default             : return os;
+  }
+}
+
+string operand::str() const {
+  switch (kind()) {
+  case _TEMP : return "%" + std::to_string(h & PAYLOAD_MASK);
+  case _INT  : return std::to_string(h & PAYLOAD_MASK);
+  case _NAME : return operandPool::current().name(h & PAYLOAD_MASK);
+  default    : return "";
+  }
+}
+
+
 ////////////////////////////////////////////////////////////////////
 /// Implementation for class 'instruction'
 
 /// Constructor
 instruction::instruction(Operation op,
-                         const std::string &a1, const std::string &a2, const std::string &a3) {
+                         const operand &a1, const operand &a2, const operand &a3) {
   oper = op;
   arg1 = a1;
   arg2 = a2;
@@ -92,65 +234,74 @@ instruction instruction::NOOP() { return instruction(_NOOP); }
 /// Destructor
 instruction::~instruction() {}
 
+static_assert(sizeof(instruction) == 16, "instruction should be 16 bytes (opcode + 3 operand handles)");
+
 string instruction::dump() const {
-  string s;
-  string ind="   ";
+  ostringstream os;
+  dump(os);
+  return os.str();
+}
+
+void instruction::dump(ostream &os) const {
+  if (oper != instruction::_LABEL) os << "   ";
   switch (oper) {
-  case instruction::_LABEL : { s = "label " + arg1 + " :"; ind = ""; break; }
-  case instruction::_UJUMP : { s = "goto " + arg1; break; }
-  case instruction::_FJUMP : { s = "ifFalse " + arg1 + " goto " +arg2; break; }
+  case instruction::_LABEL : { os << "label " << arg1 << " :"; break; }
+  case instruction::_UJUMP : { os << "goto " << arg1; break; }
+  case instruction::_FJUMP : { os << "ifFalse " << arg1 << " goto " << arg2; break; }
   case instruction::_LOAD : 
   case instruction::_FLOAD : 
-  case instruction::_ILOAD : { s = arg1 + " = " + arg2; break; } 
-  case instruction::_CHLOAD : { s = arg1 + " = '" + arg2 +"'"; break; } 
-  case instruction::_PUSH : { s = "pushparam " + (arg1.empty()? "" : arg1); break; }
-  case instruction::_POP : { s = "popparam " + (arg1.empty()? "" : arg1); break; }
-  case instruction::_CALL : { s = "call " + arg1; break; }
-  case instruction::_RETURN : { s = "return"; break; }
-  case instruction::_XLOAD : { s = arg1 + "[" + arg2 + "] = " + arg3; break; }
-  case instruction::_LOADX : { s = arg1 + " = " + arg2 + "[" + arg3 + "]"; break; }
-  case instruction::_ALOAD : { s = arg1 + " = &" + arg2; break; }
-  case instruction::_LOADC : { s = arg1 + " = *" + arg2; break; }
-  case instruction::_CLOAD : { s = "*" + arg1 + " = " + arg2; break; }
-  case instruction::_READI : { s = "readi " + arg1; break; }
-  case instruction::_READF : { s = "readf " + arg1; break; }
-  case instruction::_READC : { s = "readc " + arg1; break; }
-  case instruction::_WRITEI : { s = "writei " + arg1; break; }
-  case instruction::_WRITEF : { s = "writef " + arg1; break; }
-  case instruction::_WRITEC : { s = "writec " + arg1; break; }
-  case instruction::_WRITELN : { s = "writeln"; break; }
-  case instruction::_ADD : { s = arg1 + " = " + arg2 + " + " + arg3; break; }
-  case instruction::_SUB : { s = arg1 + " = " + arg2 + " - " + arg3; break; }
-  case instruction::_MUL : { s = arg1 + " = " + arg2 + " * " + arg3; break; }
-  case instruction::_DIV : { s = arg1 + " = " + arg2 + " / " + arg3; break; }
-  case instruction::_AND : { s = arg1 + " = " + arg2 + " and " + arg3; break; }
-  case instruction::_OR : { s = arg1 + " = " + arg2 + " or " + arg3; break; }
-  case instruction::_EQ : { s = arg1 + " = " + arg2 + " == " + arg3; break; }
-  case instruction::_LT : { s = arg1 + " = " + arg2 + " < " + arg3; break; }
-  case instruction::_LE : { s = arg1 + " = " + arg2 + " <= " + arg3; break; }
-  case instruction::_NOT : { s = arg1 + " = not " + arg2; break; }
-  case instruction::_NEG : { s = arg1 + " = - " + arg2; break; }
-  case instruction::_FADD : { s = arg1 + " = " + arg2 + " +. " + arg3; break; }
-  case instruction::_FSUB : { s = arg1 + " = " + arg2 + " -. " + arg3; break; }
-  case instruction::_FMUL : { s = arg1 + " = " + arg2 + " *. " + arg3; break; }
-  case instruction::_FDIV : { s = arg1 + " = " + arg2 + " /. " + arg3; break; }
-  case instruction::_FEQ : { s = arg1 + " = " + arg2 + " ==. " + arg3; break; }
-  case instruction::_FLT : { s = arg1 + " = " + arg2 + " <. " + arg3; break; }
-  case instruction::_FLE : { s =  arg1 + " = " + arg2 + " <=. " + arg3; break; }
-  case instruction::_FNEG : { s =  arg1 + " = -. " + arg2; break; }
-  case instruction::_FLOAT : { s = arg1 + " = float " + arg2; break; }
-  case instruction::_NOOP : { s = "noop"; break; }
-  default : { s = "????"; break; }
+  case instruction::_ILOAD : { os << arg1 << " = " << arg2; break; } 
+  case instruction::_CHLOAD : { os << arg1 << " = '" << arg2 << "'"; break; } 
+  case instruction::_PUSH : { os << "pushparam " << arg1; break; }
+  case instruction::_POP : { os << "popparam " << arg1; break; }
+  case instruction::_CALL : { os << "call " << arg1; break; }
+  case instruction::_RETURN : { os << "return"; break; }
+  case instruction::_XLOAD : { os << arg1 << "[" << arg2 << "] = " << arg3; break; }
+  case instruction::_LOADX : { os << arg1 << " = " << arg2 << "[" << arg3 << "]"; break; }
+  case instruction::_ALOAD : { os << arg1 << " = &" << arg2; break; }
+  case instruction::_LOADC : { os << arg1 << " = *" << arg2; break; }
+  case instruction::_CLOAD : { os << "*" << arg1 << " = " << arg2; break; }
+  case instruction::_READI : { os << "readi " << arg1; break; }
+  case instruction::_READF : { os << "readf " << arg1; break; }
+  case instruction::_READC : { os << "readc " << arg1; break; }
+  case instruction::_WRITEI : { os << "writei " << arg1; break; }
+  case instruction::_WRITEF : { os << "writef " << arg1; break; }
+  case instruction::_WRITEC : { os << "writec " << arg1; break; }
+  case instruction::_WRITELN : { os << "writeln"; break; }
+  case instruction::_ADD : { os << arg1 << " = " << arg2 << " + " << arg3; break; }
+  case instruction::_SUB : { os << arg1 << " = " << arg2 << " - " << arg3; break; }
+  case instruction::_MUL : { os << arg1 << " = " << arg2 << " * " << arg3; break; }
+  case instruction::_DIV : { os << arg1 << " = " << arg2 << " / " << arg3; break; }
+  case instruction::_AND : { os << arg1 << " = " << arg2 << " and " << arg3; break; }
+  case instruction::_OR : { os << arg1 << " = " << arg2 << " or " << arg3; break; }
+  case instruction::_EQ : { os << arg1 << " = " << arg2 << " == " << arg3; break; }
+  case instruction::_LT : { os << arg1 << " = " << arg2 << " < " << arg3; break; }
+  case instruction::_LE : { os << arg1 << " = " << arg2 << " <= " << arg3; break; }
+  case instruction::_NOT : { os << arg1 << " = not " << arg2; break; }
+  case instruction::_NEG : { os << arg1 << " = - " << arg2; break; }
+  case instruction::_FADD : { os << arg1 << " = " << arg2 << " +. " << arg3; break; }
+  case instruction::_FSUB : { os << arg1 << " = " << arg2 << " -. " << arg3; break; }
+  case instruction::_FMUL : { os << arg1 << " = " << arg2 << " *. " << arg3; break; }
+  case instruction::_FDIV : { os << arg1 << " = " << arg2 << " /. " << arg3; break; }
+  case instruction::_FEQ : { os << arg1 << " = " << arg2 << " ==. " << arg3; break; }
+  case instruction::_FLT : { os << arg1 << " = " << arg2 << " <. " << arg3; break; }
+  case instruction::_FLE : { os << arg1 << " = " << arg2 << " <=. " << arg3; break; }
+  case instruction::_FNEG : { os << arg1 << " = -. " << arg2; break; }
+  case instruction::_FLOAT : { os << arg1 << " = float " << arg2; break; }
+  case instruction::_NOOP : { os << "noop"; break; }
+  default : { os << "????"; break; }
   }
-
-  return ind + s;
 }
 
 ////////////////////////////////////////////////////////////////////
 // concatenation of instruction+list (or instruction+instruction, via automatic coertion)
 
 instructionList instruction::operator||(const instructionList &lst) const {
-  return instructionList(*this) || lst;
+  instructionList newlist;
+  newlist.reserve(1 + lst.size());
+  newlist.push_back(*this);
+  newlist += lst;
+  return newlist;
 }
 
 
@@ -165,17 +316,40 @@ instructionList::instructionList(const instruction &inst) { this->push_back(inst
 instructionList::~instructionList() {}
 
 // concatenation of lists (or list+instruction, via automatic coertion)
-instructionList instructionList::operator||(const instructionList &lst) const {
-  instructionList newlist = (*this);
+instructionList instructionList::operator||(const instructionList &lst) const & {
+  instructionList newlist;
+  newlist.reserve(this->size() + lst.size());
+  newlist.insert(newlist.end(), this->begin(), this->end());
   newlist.insert(newlist.end(), lst.begin(), lst.end());
   return newlist;
 }
 
+// concatenation when the left list is a temporary (e.g. a || b || c):
+// its storage is reused, so chains of || grow a single vector
+instructionList instructionList::operator||(const instructionList &lst) && {
+  (*this) += lst;
+  return std::move(*this);
+}
+
+// append in place. Amortized cost is linear in the size of lst, so
+// loops like 'code += codeS' do not copy the whole accumulated code
+instructionList & instructionList::operator+=(const instructionList &lst) {
+  this->insert(this->end(), lst.begin(), lst.end());
+  return *this;
+}
+
 // print instructionList (for debugging)
 string instructionList::dump() const {
-  string s;  
-  for (auto i : *this ) s += i.dump() + "\n";
-  return s;
+  ostringstream os;
+  dump(os);
+  return os.str();
+}
+
+void instructionList::dump(ostream &os) const {
+  for (auto & i : *this) {
+    i.dump(os);
+    os << '\n';
+  }
 }
 
 
@@ -198,15 +372,22 @@ string var::dump() const {
   return name;
 }
 
+void var::dump(ostream &os) const {
+  os << name;
+  if (size != 0) os << ' ' << size;
+}
+
 ////////////////////////////////////////////////////////////////////
 /// Implementation for class 'subroutine'
 
 /// constructor
-subroutine::subroutine(const string &sname) { name = sname; }
+subroutine::subroutine(const string &sname) : pool(operandPool::get_current()) { name = sname; }
 /// destructor
 subroutine::~subroutine() {}
 /// get subroutine name
 string subroutine::get_name() const { return name; };
+/// get the pool of its operands
+const shared_ptr<operandPool> & subroutine::get_pool() const { return pool; }
 /// add new variable
 void subroutine::add_var(const var v) { vars.push_back(v); }
 /// add new variable
@@ -215,19 +396,31 @@ void subroutine::add_var(const std::string &name, size_t sz) { vars.push_back(va
 void subroutine::add_param(const std::string &name) { params.push_back(var(name,0)); }
 /// add new instruction
 void subroutine::add_instruction(const instruction &inst) {
-  if (inst.oper == instruction::_LABEL) labels.insert(make_pair(inst.arg1,instructions.size()));
+  if (inst.oper == instruction::_LABEL) labels.insert(make_pair(inst.arg1.str(),instructions.size()));
   instructions.push_back(inst);
 }
 /// add instruction list to current instructions
 void subroutine::add_instructions(const instructionList &lins) {
-  for (auto i : lins)
+  instructions.reserve(instructions.size() + lins.size());
+  for (auto & i : lins)
     this->add_instruction(i);
 }
 /// set instruction list (overwritting current instructions)
 void subroutine::set_instructions(const instructionList &lins) {
   instructions.clear();
+  labels.clear();
   this->add_instructions(lins);
 }
+/// set instruction list taking ownership of it (no copy is made)
+void subroutine::set_instructions(instructionList &&lins) {
+  instructions = std::move(lins);
+  labels.clear();
+  for (size_t pc = 0; pc < instructions.size(); ++pc)
+    if (instructions[pc].oper == instruction::_LABEL)
+      labels.insert(make_pair(instructions[pc].arg1.str(), pc));
+}
+/// get all the instructions
+const instructionList & subroutine::get_instructions() const { return instructions; }
 /// get instruction at given program counter
 instruction subroutine::get_instruction_at(size_t pc) const {
   if (pc>=instructions.size()) return instruction(instruction::_INVALID);
@@ -237,24 +430,32 @@ instruction subroutine::get_instruction_at(size_t pc) const {
 size_t subroutine::get_label_pc(std::string &lab) const { return labels.find(lab)->second; }
 /// print (for debugging)
 string subroutine::dump() const {
-  string s;
-  s = "function " + name + "\n";
+  ostringstream os;
+  dump(os);
+  return os.str();
+}
+
+void subroutine::dump(ostream &os) const {
+  operandPool::scope names(pool);
+  os << "function " << name << "\n";
   if (not params.empty()) {
-    s += "  params\n" ;
-    for (auto p : params) s += "    " + p.dump() + "\n";
-    s += "  endparams\n\n";
+    os << "  params\n";
+    for (auto & p : params) { os << "    "; p.dump(os); os << "\n"; }
+    os << "  endparams\n\n";
   }
   if (not vars.empty()) {
-    s += "  vars\n";
-    for (auto v : vars) s += "    " + v.dump() + "\n";
-    s += "  endvars\n\n";
+    os << "  vars\n";
+    for (auto & v : vars) { os << "    "; v.dump(os); os << "\n"; }
+    os << "  endvars\n\n";
   }
 
-  string ind = "  ";
-  if (labels.empty()) ind="";
-  for (auto i : instructions) s += ind + i.dump() + "\n";  
-  s += "endfunction\n\n";
-  return s;
+  const char *ind = labels.empty() ? "" : "  ";
+  for (auto & i : instructions) {
+    os << ind;
+    i.dump(os);
+    os << "\n";
+  }
+  os << "endfunction\n\n";
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -272,24 +473,33 @@ const subroutine& code::get_subroutine(const string &name) const {
   size_t p = names.find(name)->second;
   return subs[p];
 }
+/// get all the subroutines
+const vector<subroutine>& code::get_subroutines() const { return subs; }
 /// add subroutine
 void code::add_subroutine(const subroutine &s) {
   subs.push_back(s);
   names.insert(make_pair(s.get_name(), subs.size()-1));
 }
+/// add subroutine (moving it)
+void code::add_subroutine(subroutine &&s) {
+  string name = s.get_name();
+  subs.push_back(std::move(s));
+  names.insert(make_pair(name, subs.size()-1));
+}
 /// print (for debugging)
 string code::dump() const {
-  string c;
-  for (auto s : subs) c += s.dump();
-  return c;
+  ostringstream os;
+  dump(os);
+  return os.str();
+}
+
+void code::dump(ostream &os) const {
+  for (auto & s : subs) s.dump(os);
 }
 
 
 ////////////////////////////////////////////////////////////////////
-/// Static methods to manage counters
-int counters::countIF = 0;
-int counters::countWHILE = 0;
-int counters::countTEMP = 0;
+/// Methods to manage counters
 
 string counters::newLabelIF() { return std::to_string(++countIF); }
 string counters::newLabelWHILE() { return std::to_string(++countWHILE); }
@@ -29,12 +29,113 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 #include <list>
 #include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <iosfwd>
 
 /// predeclaration
 class instructionList;
 
+////////////////////////////////////////////////////////////////////
+/// Class operandPool keeps the texts of the operands that are not
+/// stored inline (see operand), each distinct one only once. Operands
+/// are built and printed with the pool that is current in the calling
+/// thread (see operandPool::scope); without one, the pool of the
+/// process is used. A compilation makes a pool of its own current, so
+/// its texts are freed with it and it shares no lock with others
+/// running at the same time. A pool can be used from several threads.
+
+class operandPool {
+public:
+  /// constructor and destructor
+  operandPool();
+  ~operandPool();
+  operandPool(const operandPool &) = delete;
+  operandPool & operator=(const operandPool &) = delete;
+
+  /// intern a string and return its position in the pool
+  uint32_t intern(const std::string &s);
+  /// interned string at a given position
+  const std::string & name(uint32_t pos) const;
+
+  /// pool current in the calling thread
+  static operandPool & current();
+  static std::shared_ptr<operandPool> get_current();
+
+  /// makes a pool current in the calling thread while it lives
+  class scope {
+  public:
+    explicit scope(const std::shared_ptr<operandPool> &p);
+    ~scope();
+    scope(const scope &) = delete;
+    scope & operator=(const scope &) = delete;
+  private:
+    std::shared_ptr<operandPool> previous;
+  };
+
+private:
+  /// the strings are kept in chunks that never move (chunk k holds
+  /// 2^(FIRST_CHUNK_BITS+k) of them), so that name() can read them
+  /// without locking while other threads add new ones
+  static const unsigned FIRST_CHUNK_BITS = 8;
+  static const unsigned NUM_CHUNKS = 30 - FIRST_CHUNK_BITS + 1;
+  std::atomic<std::string *> chunks[NUM_CHUNKS];
+  uint32_t numNames;
+  /// index from strings to positions, protected by the mutex
+  std::unordered_map<std::string, uint32_t> index;
+  std::mutex indexMutex;
+};
+
+////////////////////////////////////////////////////////////////////
+/// Class operand is a compact (32-bit) handle for an instruction
+/// argument. Temporals ("%12") and non-negative integer constants are
+/// stored inline; any other text (variables, labels, subroutine
+/// names, float or char constants...) is interned in the current
+/// operandPool, so each distinct string is allocated only once. An
+/// operand only has a meaning in the pool it was built with.
+
+class operand {
+public:
+  /// kind of operand, kept in the two highest bits of the handle
+  typedef enum {_NONE=0, _TEMP=1, _INT=2, _NAME=3} Kind;
+
+  /// constructors (implicit, so that a string can be used wherever an
+  /// operand is expected)
+  operand();
+  operand(const std::string &s);
+  operand(const char *s);
+  /// temporal or integer constant with the given number
+  operand(Kind k, uint32_t n);
+
+  /// kind of the operand
+  Kind kind() const;
+  /// true if the operand is absent (empty string)
+  bool empty() const;
+  /// text of the operand, exactly as it was given
+  std::string str() const;
+  /// raw handle (equal handles <=> equal texts)
+  uint32_t handle() const;
+  /// number of a temporal, value of an integer constant
+  uint32_t value() const;
+  /// largest number that can be stored inline
+  static const uint32_t MAX_VALUE = (uint32_t(1) << 30) - 1;
+
+  bool operator==(const operand &o) const;
+  bool operator!=(const operand &o) const;
+
+  /// write the text of the operand (without building a string)
+  friend std::ostream & operator<<(std::ostream &os, const operand &o);
+
+private:
+  uint32_t h;
+};
+
 ////////////////////////////////////////////////////////////////////
 /// Class instruction stores a VM instruction code with its operands
 
@@ -50,15 +151,22 @@ public:
   /// instruction code
   Operation oper;
   /// arguments
-  std::string arg1, arg2, arg3;
+  operand arg1, arg2, arg3;
   
   /// constructor
   instruction(Operation op,
-              const std::string &a1="", const std::string &a2="", const std::string &a3="");
+              const operand &a1=operand(), const operand &a2=operand(), const operand &a3=operand());
 
   /// destructor
   ~instruction();
 
+  /// copy and move (the user-declared destructor would otherwise
+  /// disable the implicit move operations)
+  instruction(const instruction &) = default;
+  instruction(instruction &&) = default;
+  instruction & operator=(const instruction &) = default;
+  instruction & operator=(instruction &&) = default;
+
   // concatenation of instruction+list (or instruction+instruction, via automatic coertion)
   instructionList operator||(const instructionList &lst) const;
 
@@ -155,6 +263,7 @@ public:
   
   // print instruction
   std::string dump() const;   
+  void dump(std::ostream &os) const;
 };
 
 
@@ -170,11 +279,22 @@ public:
   // destructor
   ~instructionList();
 
+  // copy and move
+  instructionList(const instructionList &) = default;
+  instructionList(instructionList &&) = default;
+  instructionList & operator=(const instructionList &) = default;
+  instructionList & operator=(instructionList &&) = default;
+
   // concatenation of lists (or list+instruction, via automatic coertion)
-  instructionList operator||(const instructionList &lst) const;
+  instructionList operator||(const instructionList &lst) const &;
+  // concatenation reusing this (temporary) list instead of copying it
+  instructionList operator||(const instructionList &lst) &&;
+  // append a list (or instruction) at the end of this one, in place
+  instructionList & operator+=(const instructionList &lst);
 
   // print instructionList
   std::string dump() const;   
+  void dump(std::ostream &os) const;
 };
 
 
@@ -191,6 +311,7 @@ public:
 
   // print var
   std::string dump() const; 
+  void dump(std::ostream &os) const;
 };
 
 
@@ -202,6 +323,9 @@ class subroutine {
 private:
   /// name of the subroutine
   std::string name;
+  /// pool of the operands of its instructions (the current one when
+  /// it was created)
+  std::shared_ptr<operandPool> pool;
   /// instructions
   instructionList instructions;
   /// map label name -> position in instructions
@@ -216,9 +340,16 @@ public:
   /// constructor and destructor
   subroutine(const std::string &sname);
   ~subroutine();
+  /// copy and move
+  subroutine(const subroutine &) = default;
+  subroutine(subroutine &&) = default;
+  subroutine & operator=(const subroutine &) = default;
+  subroutine & operator=(subroutine &&) = default;
 
   /// get subroutine name
   std::string get_name() const;
+  /// get the pool of its operands
+  const std::shared_ptr<operandPool> & get_pool() const;
   /// add a local var to subroutine
   void add_var(const var v);
   /// add a local var to subroutine
@@ -229,8 +360,12 @@ public:
   void add_instruction(const instruction &inst);
   /// add instruction list to current instructions
   void add_instructions(const instructionList &lins);
+  /// get all the instructions
+  const instructionList & get_instructions() const;
   /// set instruction list (overwritting current instructions)
   void set_instructions(const instructionList &lins);
+  /// set instruction list taking ownership of it (no copy is made)
+  void set_instructions(instructionList &&lins);
   
   /// get instruction at given program counter in subroutine
   instruction get_instruction_at(size_t pc) const;
@@ -239,10 +374,12 @@ public:
 
   // print subroutine (params, vars, and instructions)
   std::string dump() const;
+  void dump(std::ostream &os) const;
 };
 
 ////////////////////////////////////////////////////////////////////
-/// Class code stores a whole program (main plus subroutines)
+/// Class code stores a whole program (main plus subroutines). All its
+/// subroutines have to share the same operandPool
 
 class code {
 private:
@@ -260,11 +397,17 @@ public:
   subroutine& get_last_subroutine();
   /// get subroutine by name
   const subroutine& get_subroutine(const std::string &name) const;
+  /// get all the subroutines, in the order they were added
+  const std::vector<subroutine>& get_subroutines() const;
   /// add new subroutine
   void add_subroutine(const subroutine &s);
+  /// add new subroutine taking ownership of it (no copy is made)
+  void add_subroutine(subroutine &&s);
 
-  // print code (all info for all subroutines)
+  // print code (all info for all subroutines). The ostream version
+  // writes each subroutine directly, without building the whole text
   std::string dump() const;
+  void dump(std::ostream &os) const;
 };
 
 
@@ -273,24 +416,26 @@ public:
 
 class counters {
 private:
-  static int countIF;
-  static int countWHILE;
-  static int countTEMP;
+  // each object has its own counters, so that several code generators
+  // can run at the same time
+  int countIF = 0;
+  int countWHILE = 0;
+  int countTEMP = 0;
 
 public:
   // return id for new label or temp (id is a number, but returned as string
   // to ease concatenation with other literals (e.g. "labelIF" + "4" -> "LabelIF4")
-  static std::string newLabelIF();
-  static std::string newLabelWHILE();
-  static std::string newTEMP();
+  std::string newLabelIF();
+  std::string newLabelWHILE();
+  std::string newTEMP();
   
   // reset individual counters 
-  static void resetLabelIF();
-  static void resetLabelWHILE();
-  static void resetTEMP();
+  void resetLabelIF();
+  void resetLabelWHILE();
+  void resetTEMP();
   
   // reset label counters (IF and WHILE)
-  static void resetLabels();
+  void resetLabels();
   // reset all counters (IF, WHILE, and TEMP)
-  static void reset();
+  void reset();
 };
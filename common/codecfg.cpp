@@ -0,0 +1,250 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    codecfg - Control flow graph and dataflow analysis of the
+//              t-code of a subroutine
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "codecfg.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+// Class bitVector
+
+bitVector::bitVector(size_t size) : n(size), words((size + 63) / 64, 0) {
+}
+
+size_t bitVector::size() const {
+  return n;
+}
+
+bool bitVector::test(size_t i) const {
+  return (words[i / 64] >> (i % 64)) & 1;
+}
+
+void bitVector::set(size_t i) {
+  words[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+void bitVector::reset(size_t i) {
+  words[i / 64] &= ~(uint64_t(1) << (i % 64));
+}
+
+void bitVector::fill() {
+  std::fill(words.begin(), words.end(), ~uint64_t(0));
+  // the bits past the size are kept clear, so that == holds
+  if (n % 64 != 0) words.back() = (uint64_t(1) << (n % 64)) - 1;
+}
+
+bool bitVector::unite(const bitVector & o) {
+  bool changed = false;
+  for (size_t w = 0; w < words.size(); ++w) {
+    uint64_t v = words[w] | o.words[w];
+    if (v != words[w]) {
+      words[w] = v;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+bool bitVector::intersect(const bitVector & o) {
+  bool changed = false;
+  for (size_t w = 0; w < words.size(); ++w) {
+    uint64_t v = words[w] & o.words[w];
+    if (v != words[w]) {
+      words[w] = v;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void bitVector::subtract(const bitVector & o) {
+  for (size_t w = 0; w < words.size(); ++w)
+    words[w] &= ~o.words[w];
+}
+
+bool bitVector::operator==(const bitVector & o) const {
+  return n == o.n and words == o.words;
+}
+
+bool bitVector::operator!=(const bitVector & o) const {
+  return not (*this == o);
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Class flowGraph
+
+flowGraph::flowGraph(const instructionList & instrs) : blockOf(instrs.size(), 0) {
+  unordered_map<uint32_t, size_t> blockOfLabel;
+  for (size_t k = 0; k < instrs.size(); ) {
+    if (instrs[k].oper == instruction::_LABEL)
+      blockOfLabel[instrs[k].arg1.handle()] = blocks.size();
+    size_t last = k;
+    while (last + 1 < instrs.size() and instrs[last + 1].oper != instruction::_LABEL and
+           instrs[last].oper != instruction::_UJUMP and instrs[last].oper != instruction::_FJUMP and
+           instrs[last].oper != instruction::_RETURN)
+      ++last;
+    for (size_t j = k; j <= last; ++j) blockOf[j] = blocks.size();
+    blocks.push_back(basicBlock{k, last, {}, {}});
+    k = last + 1;
+  }
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    const instruction & i = instrs[blocks[b].last];
+    if (i.oper == instruction::_UJUMP or i.oper == instruction::_FJUMP) {
+      auto f = blockOfLabel.find((i.oper == instruction::_UJUMP ? i.arg1 : i.arg2).handle());
+      if (f != blockOfLabel.end()) blocks[b].succs.push_back(f->second);
+    }
+    // an FJUMP to the next block goes there either way
+    if (i.oper != instruction::_UJUMP and i.oper != instruction::_RETURN and b + 1 < blocks.size() and
+        (blocks[b].succs.empty() or blocks[b].succs[0] != b + 1))
+      blocks[b].succs.push_back(b + 1);
+  }
+  for (size_t b = 0; b < blocks.size(); ++b)
+    for (size_t succ : blocks[b].succs) blocks[succ].preds.push_back(b);
+}
+
+size_t flowGraph::num_blocks() const {
+  return blocks.size();
+}
+
+const basicBlock & flowGraph::get_block(size_t b) const {
+  return blocks[b];
+}
+
+size_t flowGraph::get_block_of(size_t pc) const {
+  return blockOf[pc];
+}
+
+vector<bool> flowGraph::get_reachable() const {
+  vector<bool> reached(blocks.size(), false);
+  if (blocks.empty()) return reached;
+  vector<size_t> pending(1, 0);
+  reached[0] = true;
+  while (not pending.empty()) {
+    size_t b = pending.back();
+    pending.pop_back();
+    for (size_t succ : blocks[b].succs)
+      if (not reached[succ]) {
+        reached[succ] = true;
+        pending.push_back(succ);
+      }
+  }
+  return reached;
+}
+
+vector<size_t> flowGraph::get_reverse_postorder() const {
+  vector<size_t> order;
+  if (blocks.empty()) return order;
+  order.reserve(blocks.size());
+  // depth first, without recursion: each entry is a block and the
+  // next of its successors to visit
+  vector<bool> visited(blocks.size(), false);
+  vector<pair<size_t, size_t>> path(1, make_pair(size_t(0), size_t(0)));
+  visited[0] = true;
+  while (not path.empty()) {
+    pair<size_t, size_t> & top = path.back();
+    const vector<size_t> & succs = blocks[top.first].succs;
+    if (top.second < succs.size()) {
+      size_t succ = succs[top.second++];
+      if (not visited[succ]) {
+        visited[succ] = true;
+        path.push_back(make_pair(succ, size_t(0)));
+      }
+    }
+    else {
+      order.push_back(top.first);
+      path.pop_back();
+    }
+  }
+  reverse(order.begin(), order.end());
+  return order;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Dataflow analysis
+
+dataflowProblem::dataflowProblem(const flowGraph & g, size_t bits, Direction dir, Meet m) :
+  direction(dir), meet(m),
+  gen(g.num_blocks(), bitVector(bits)), kill(g.num_blocks(), bitVector(bits)),
+  boundary(bits) {
+}
+
+dataflowSolution solve_dataflow(const flowGraph & g, const dataflowProblem & p) {
+  size_t nblocks = g.num_blocks();
+  size_t bits = p.boundary.size();
+  bool forward = p.direction == dataflowProblem::FORWARD;
+  bool isUnion = p.meet == dataflowProblem::UNION;
+
+  // the sets where the meet is taken ('before') and the ones given by
+  // the transfer function ('after'): in and out for forward problems,
+  // out and in for backward ones
+  dataflowSolution sol;
+  bitVector top(bits);
+  if (not isUnion) top.fill();
+  sol.in.assign(nblocks, top);
+  sol.out.assign(nblocks, top);
+  vector<bitVector> & before = forward ? sol.in : sol.out;
+  vector<bitVector> & after = forward ? sol.out : sol.in;
+
+  // the blocks in the order the sets flow, so that most are computed
+  // once their inputs are, and the others are taken again from the
+  // worklist
+  vector<size_t> order = g.get_reverse_postorder();
+  if (not forward) reverse(order.begin(), order.end());
+  vector<bool> queued(nblocks, false);
+  vector<size_t> worklist(order.rbegin(), order.rend());
+  for (size_t b : order) queued[b] = true;
+
+  while (not worklist.empty()) {
+    size_t b = worklist.back();
+    worklist.pop_back();
+    queued[b] = false;
+    const basicBlock & blk = g.get_block(b);
+    const vector<size_t> & inputs = forward ? blk.preds : blk.succs;
+    const vector<size_t> & outputs = forward ? blk.succs : blk.preds;
+
+    bitVector & set = before[b];
+    bool boundary = forward ? b == 0 : blk.succs.empty();
+    if (boundary) set = p.boundary;
+    else set = top;
+    for (size_t i : inputs) {
+      if (isUnion) set.unite(after[i]);
+      else         set.intersect(after[i]);
+    }
+    bitVector result = set;
+    result.subtract(p.kill[b]);
+    result.unite(p.gen[b]);
+    if (result == after[b]) continue;
+    after[b] = std::move(result);
+    for (size_t o : outputs)
+      if (not queued[o]) {
+        queued[o] = true;
+        worklist.push_back(o);
+      }
+  }
+  return sol;
+}
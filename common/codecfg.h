@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    codecfg - Control flow graph and dataflow analysis of the
+//              t-code of a subroutine
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+//////////////////////////////////////////////////////////////////////
+// Class bitVector: a set of the integers 0 .. size-1, one bit each
+
+class bitVector {
+public:
+  // an empty set of integers below 'size'
+  explicit bitVector(std::size_t size = 0);
+
+  std::size_t size() const;
+  bool test(std::size_t i) const;
+  void set(std::size_t i);
+  void reset(std::size_t i);
+  // add all the integers below size
+  void fill();
+
+  // set operations in place: union, intersection and difference.
+  // The first two return true if this set changed
+  bool unite(const bitVector & o);
+  bool intersect(const bitVector & o);
+  void subtract(const bitVector & o);
+
+  bool operator==(const bitVector & o) const;
+  bool operator!=(const bitVector & o) const;
+
+private:
+  std::size_t           n;
+  std::vector<uint64_t> words;
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// Class flowGraph: the basic blocks of a list of instructions and the
+// jumps between them. A block starts at the first instruction and at
+// every LABEL, and it ends at a UJUMP, FJUMP or RETURN (or before the
+// next LABEL). Block 0 is the entry. The successors of a block are
+// the target of its jump, if any, and the next block, unless it ends
+// with a UJUMP or a RETURN. A jump to a label that does not exist has
+// no successor for it.
+
+struct basicBlock {
+  // its instructions: from 'first' to 'last', both included
+  std::size_t first, last;
+  std::vector<std::size_t> succs, preds;
+};
+
+class flowGraph {
+public:
+  explicit flowGraph(const instructionList & instrs);
+
+  std::size_t num_blocks() const;
+  const basicBlock & get_block(std::size_t b) const;
+  // the block of the instruction at 'pc'
+  std::size_t get_block_of(std::size_t pc) const;
+  // the blocks that can be reached from the entry
+  std::vector<bool> get_reachable() const;
+  // the reachable blocks, each one before its successors except on
+  // the jumps back of loops (reverse postorder)
+  std::vector<std::size_t> get_reverse_postorder() const;
+
+private:
+  std::vector<basicBlock>  blocks;
+  std::vector<std::size_t> blockOf;
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// Dataflow problems on sets of bits, in the gen/kill form: the set
+// after a block (before it, for backward problems) is
+//     gen[b] + (set before it - kill[b])
+// and the set before a block is the union (or intersection) of the
+// sets after its predecessors (successors, for backward problems).
+// The boundary is the set before the entry (forward), or after the
+// blocks without successors (backward).
+
+struct dataflowProblem {
+  typedef enum {FORWARD, BACKWARD} Direction;
+  typedef enum {UNION, INTERSECTION} Meet;
+
+  // a problem on sets of 'bits' bits for the blocks of 'g', with
+  // empty gen, kill and boundary sets
+  dataflowProblem(const flowGraph & g, std::size_t bits, Direction dir, Meet meet);
+
+  Direction              direction;
+  Meet                   meet;
+  std::vector<bitVector> gen, kill;
+  bitVector              boundary;
+};
+
+// the sets at the start ('in') and at the end ('out') of each block
+struct dataflowSolution {
+  std::vector<bitVector> in, out;
+};
+
+// Solve the problem with a worklist of the blocks whose sets may
+// change, until none does (the blocks that can not be reached have
+// empty sets, or full ones with INTERSECTION)
+dataflowSolution solve_dataflow(const flowGraph & g, const dataflowProblem & p);
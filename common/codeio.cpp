@@ -0,0 +1,669 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    codeio - Reading and writing t-code for
+//             the Asl programming language
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "codeio.h"
+
+#include <algorithm>
+#include <fstream>
+#include <streambuf>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Text t-code
+
+// true if s is an integer constant (an optional sign and digits)
+static bool isIntLiteral(const string &s) {
+  size_t i = (s[0] == '-' or s[0] == '+') ? 1 : 0;
+  if (i == s.size()) return false;
+  for (; i < s.size(); ++i)
+    if (s[i] < '0' or s[i] > '9') return false;
+  return true;
+}
+
+// true if s is a float constant (a number with a dot or an exponent)
+static bool isFloatLiteral(const string &s) {
+  if (s.find_first_of(".eE") == string::npos) return false;
+  if (not isdigit(s[0]) and s[0] != '.' and s[0] != '-' and s[0] != '+') return false;
+  char *end;
+  strtod(s.c_str(), &end);
+  return *end == '\0';
+}
+
+// split an instruction in tokens: names and numbers, and the
+// symbols '[', ']', '&', '*', ':' and runs of operator characters
+static vector<string> tokenize(const string &line) {
+  vector<string> toks;
+  size_t i = 0, n = line.size();
+  while (i < n) {
+    char ch = line[i];
+    if (isspace((unsigned char)ch)) { ++i; continue; }
+    size_t j = i+1;
+    if (isalnum((unsigned char)ch) or ch == '_' or ch == '%' or
+        (ch == '.' and j < n and isdigit((unsigned char)line[j]))) {
+      while (j < n and (isalnum((unsigned char)line[j]) or line[j] == '_' or line[j] == '.'))
+        ++j;
+    }
+    else if (ch == '[' or ch == ']' or ch == '&' or ch == '*' or ch == ':') {
+      // single character symbol ('*' may be an operator too: "*.")
+      if (ch == '*' and j < n and line[j] == '.') ++j;
+    }
+    else {
+      while (j < n and strchr("+-/=<>!.", line[j]) and line[j] != '\0') ++j;
+    }
+    toks.push_back(line.substr(i, j-i));
+    i = j;
+  }
+  return toks;
+}
+
+static const map<string, instruction::Operation> BinaryOps = {
+  {"+",  instruction::_ADD},  {"-",  instruction::_SUB},
+  {"*",  instruction::_MUL},  {"/",  instruction::_DIV},
+  {"==", instruction::_EQ},   {"<",  instruction::_LT},
+  {"<=", instruction::_LE},   {"and",instruction::_AND},
+  {"or", instruction::_OR},   {"+.", instruction::_FADD},
+  {"-.", instruction::_FSUB}, {"*.", instruction::_FMUL},
+  {"/.", instruction::_FDIV}, {"==.",instruction::_FEQ},
+  {"<.", instruction::_FLT},  {"<=.",instruction::_FLE}
+};
+
+static const map<string, instruction::Operation> UnaryOps = {
+  {"not", instruction::_NOT}, {"-",  instruction::_NEG},
+  {"-.",  instruction::_FNEG}, {"float", instruction::_FLOAT},
+  {"&",   instruction::_ALOAD}, {"*", instruction::_LOADC}
+};
+
+static const map<string, instruction::Operation> SingleArgOps = {
+  {"goto",   instruction::_UJUMP},  {"call",   instruction::_CALL},
+  {"readi",  instruction::_READI},  {"readf",  instruction::_READF},
+  {"readc",  instruction::_READC},  {"writei", instruction::_WRITEI},
+  {"writef", instruction::_WRITEF}, {"writec", instruction::_WRITEC}
+};
+
+// position of the quote closing the character constant that starts
+// at q (npos if there is none)
+static size_t charEnd(const string &line, size_t q) {
+  if (q+1 >= line.size()) return string::npos;
+  return line.find('\'', q + (line[q+1] == '\\' ? 3 : 2));
+}
+
+// remove the comment (";;;" up to the end of the line), if any
+static void stripComment(string &line) {
+  size_t from = 0, q = line.find('\'');
+  if (q != string::npos and q < line.find(";;;")) {
+    from = charEnd(line, q);
+    if (from == string::npos) return;
+  }
+  size_t cm = line.find(";;;", from);
+  if (cm != string::npos) line.erase(cm);
+}
+
+// parse one instruction (without comments). Returns false if the
+// text is not a valid instruction
+static bool parseInstruction(const string &line, instruction &inst) {
+  // character constants may contain any symbol: "a = 'c'"
+  size_t q = line.find('\'');
+  if (q != string::npos) {
+    size_t eq = line.find('=');
+    if (eq == string::npos or eq > q) return false;
+    vector<string> lhs = tokenize(line.substr(0, eq));
+    size_t e = charEnd(line, q);
+    if (lhs.size() != 1 or e == string::npos or
+        line.find_first_not_of(" \t", eq+1) != q or
+        line.find_first_not_of(" \t\r", e+1) != string::npos)
+      return false;
+    inst = instruction::CHLOAD(lhs[0], line.substr(q+1, e-q-1));
+    return true;
+  }
+
+  vector<string> t = tokenize(line);
+  size_t n = t.size();
+  if (n == 0) return false;
+
+  if (t[0] == "label") {
+    if (n != 3 or t[2] != ":") return false;
+    inst = instruction::LABEL(t[1]);
+    return true;
+  }
+  if (t[0] == "ifFalse") {
+    if (n != 4 or t[2] != "goto") return false;
+    inst = instruction::FJUMP(t[1], t[3]);
+    return true;
+  }
+  if (t[0] == "pushparam" or t[0] == "popparam") {
+    if (n > 2) return false;
+    string a = (n == 2) ? t[1] : "";
+    inst = (t[0] == "pushparam") ? instruction::PUSH(a) : instruction::POP(a);
+    return true;
+  }
+  if (n == 1) {
+    if (t[0] == "return")  { inst = instruction::RETURN();  return true; }
+    if (t[0] == "writeln") { inst = instruction::WRITELN(); return true; }
+    if (t[0] == "noop")    { inst = instruction::NOOP();    return true; }
+    return false;
+  }
+  auto s = SingleArgOps.find(t[0]);
+  if (s != SingleArgOps.end()) {
+    if (n != 2) return false;
+    inst = instruction(s->second, t[1]);
+    return true;
+  }
+  // *a = b
+  if (t[0] == "*") {
+    if (n != 4 or t[2] != "=") return false;
+    inst = instruction::CLOAD(t[1], t[3]);
+    return true;
+  }
+  // a[b] = c
+  if (t[1] == "[") {
+    if (n != 6 or t[3] != "]" or t[4] != "=") return false;
+    inst = instruction::XLOAD(t[0], t[2], t[5]);
+    return true;
+  }
+  if (t[1] != "=") return false;
+
+  // a = b
+  if (n == 3) {
+    if (isIntLiteral(t[2]))        inst = instruction::ILOAD(t[0], t[2]);
+    else if (isFloatLiteral(t[2])) inst = instruction::FLOAD(t[0], t[2]);
+    else                           inst = instruction::LOAD(t[0], t[2]);
+    return true;
+  }
+  // a = op b
+  if (n == 4) {
+    auto u = UnaryOps.find(t[2]);
+    if (u == UnaryOps.end()) return false;
+    inst = instruction(u->second, t[0], t[3]);
+    return true;
+  }
+  // a = b op c
+  if (n == 5) {
+    auto b = BinaryOps.find(t[3]);
+    if (b == BinaryOps.end()) return false;
+    inst = instruction(b->second, t[0], t[2], t[4]);
+    return true;
+  }
+  // a = b[c]
+  if (n == 6 and t[3] == "[" and t[5] == "]") {
+    inst = instruction::LOADX(t[0], t[2], t[4]);
+    return true;
+  }
+  return false;
+}
+
+bool parse_code(istream &is, code &c, string &error) {
+  enum { OUTSIDE, BODY, PARAMS, VARS } state = OUTSIDE;
+  subroutine sub("");
+  instructionList instrs;
+  string line;
+  size_t nline = 0;
+
+  while (getline(is, line)) {
+    ++nline;
+    stripComment(line);
+    size_t f = line.find_first_not_of(" \t\r");
+    if (f == string::npos) continue;
+    line.erase(0, f);
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+
+    vector<string> t = tokenize(line);
+    if (state == OUTSIDE) {
+      if (t.size() != 2 or t[0] != "function") {
+        error = "line " + to_string(nline) + ": 'function' expected";
+        return false;
+      }
+      sub = subroutine(t[1]);
+      instrs.clear();
+      state = BODY;
+    }
+    else if (state == PARAMS) {
+      if (t.size() == 1 and t[0] == "endparams") state = BODY;
+      else if (t.size() == 1) sub.add_param(t[0]);
+      else {
+        error = "line " + to_string(nline) + ": wrong parameter declaration";
+        return false;
+      }
+    }
+    else if (state == VARS) {
+      if (t.size() == 1 and t[0] == "endvars") state = BODY;
+      else if (t.size() == 2 and isIntLiteral(t[1]) and t[1][0] != '-')
+        sub.add_var(t[0], strtoul(t[1].c_str(), nullptr, 10));
+      else {
+        error = "line " + to_string(nline) + ": wrong variable declaration";
+        return false;
+      }
+    }
+    else if (line == "params")  state = PARAMS;
+    else if (line == "vars")    state = VARS;
+    else if (line == "endfunction") {
+      sub.set_instructions(std::move(instrs));
+      instrs = instructionList();
+      c.add_subroutine(std::move(sub));
+      sub = subroutine("");
+      state = OUTSIDE;
+    }
+    else {
+      instruction inst(instruction::_NOOP);
+      if (not parseInstruction(line, inst)) {
+        error = "line " + to_string(nline) + ": wrong instruction '" + line + "'";
+        return false;
+      }
+      instrs.push_back(inst);
+    }
+  }
+
+  if (state != OUTSIDE) {
+    error = "line " + to_string(nline) + ": 'endfunction' expected";
+    return false;
+  }
+  return true;
+}
+
+// a read-only stream buffer over memory that is not copied
+struct membuf : streambuf {
+  membuf(const char *data, size_t size) {
+    char *p = const_cast<char *>(data);
+    setg(p, p, p + size);
+  }
+};
+
+bool parse_code(const char *data, size_t size, code &c, string &error) {
+  membuf buf(data, size);
+  istream is(&buf);
+  return parse_code(is, c, error);
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// Binary t-code
+
+static const char     MAGIC[8] = {'T','C','O','D','E','B','I','N'};
+static const uint64_t HEADER_SIZE = 16;
+
+// file header
+struct fileheader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+// trailer, at the end of the file
+struct filetrailer {
+  uint64_t records, nrecords;
+  uint64_t subs, nsubs;
+  uint64_t aux, naux;
+  uint64_t strings, nstrings;
+  char     magic[8];
+};
+
+static_assert(sizeof(fileheader) == HEADER_SIZE, "unexpected header layout");
+static_assert(sizeof(filetrailer) == 72, "unexpected trailer layout");
+static_assert(sizeof(bincodeReader::record) == 16, "unexpected record layout");
+// the structs above are written and mapped back as they are in memory,
+// so the files are only little-endian on a little-endian host
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "binary t-code needs a little-endian host");
+
+static const uint32_t KIND_SHIFT   = 30;
+static const uint32_t PAYLOAD_MASK = operand::MAX_VALUE;
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'bincodeWriter'
+
+bincodeWriter::bincodeWriter(ostream &os) : os(os), pos(0), nrecords(0) {
+  fileheader h;
+  memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = BINCODE_VERSION;
+  h.reserved = 0;
+  os.write((const char *)&h, sizeof(h));
+  pos = sizeof(h);
+}
+
+// index of a string in the string table of the file
+uint32_t bincodeWriter::str(const string &s) {
+  auto it = stringIdx.find(s);
+  if (it != stringIdx.end()) return it->second;
+  uint32_t id = strings.size();
+  strings.push_back(s);
+  stringIdx.insert(make_pair(s, id));
+  return id;
+}
+
+// encoding of an argument: as the operand, but names refer to the
+// string table of the file, not to the one of this process
+uint32_t bincodeWriter::arg(const operand &o) {
+  if (o.kind() != operand::_NAME) return o.handle();
+  return (uint32_t(operand::_NAME) << KIND_SHIFT) | str(o.str());
+}
+
+// pad with zeros up to a multiple of 8 bytes
+void bincodeWriter::align() {
+  static const char zeros[8] = {0};
+  if (pos % 8) {
+    os.write(zeros, 8 - pos % 8);
+    pos += 8 - pos % 8;
+  }
+}
+
+void bincodeWriter::add_subroutine(const subroutine &s) {
+  operandPool::scope names(s.get_pool());
+  subentry e;
+  e.name = str(s.get_name());
+  e.nparams = s.params.size();
+  e.nvars = s.vars.size();
+  e.first_record = nrecords;
+  e.first_aux = aux.size();
+
+  for (auto &p : s.params) aux.push_back(str(p.name));
+  for (auto &v : s.vars) {
+    aux.push_back(str(v.name));
+    aux.push_back(v.size);
+  }
+
+  // records, remembering where the labels are
+  vector<pair<string, uint32_t>> labels;
+  const instructionList &instrs = s.get_instructions();
+  vector<bincodeReader::record> buf(instrs.size());
+  for (size_t pc = 0; pc < instrs.size(); ++pc) {
+    const instruction &i = instrs[pc];
+    if (i.oper == instruction::_LABEL) labels.push_back(make_pair(i.arg1.str(), pc));
+    buf[pc].oper = i.oper;
+    buf[pc].arg1 = arg(i.arg1);
+    buf[pc].arg2 = arg(i.arg2);
+    buf[pc].arg3 = arg(i.arg3);
+  }
+  os.write((const char *)buf.data(), buf.size() * sizeof(bincodeReader::record));
+  pos += buf.size() * sizeof(bincodeReader::record);
+  nrecords += buf.size();
+  e.nrecords = buf.size();
+
+  // labels sorted by name (keeping the first one, as subroutine does),
+  // so that the reader can look them up with a binary search
+  stable_sort(labels.begin(), labels.end(),
+              [](const pair<string, uint32_t> &a, const pair<string, uint32_t> &b)
+              { return a.first < b.first; });
+  labels.erase(unique(labels.begin(), labels.end(),
+                      [](const pair<string, uint32_t> &a, const pair<string, uint32_t> &b)
+                      { return a.first == b.first; }),
+               labels.end());
+  e.nlabels = labels.size();
+  for (auto &l : labels) {
+    aux.push_back(str(l.first));
+    aux.push_back(l.second);
+  }
+  subs.push_back(e);
+}
+
+bool bincodeWriter::finish() {
+  filetrailer t;
+  t.records = HEADER_SIZE;
+  t.nrecords = nrecords;
+
+  align();
+  t.subs = pos;
+  t.nsubs = subs.size();
+  os.write((const char *)subs.data(), subs.size() * sizeof(subentry));
+  pos += subs.size() * sizeof(subentry);
+
+  align();
+  t.aux = pos;
+  t.naux = aux.size();
+  os.write((const char *)aux.data(), aux.size() * sizeof(uint32_t));
+  pos += aux.size() * sizeof(uint32_t);
+
+  // string table: offsets (one more than strings) and characters
+  align();
+  t.strings = pos;
+  t.nstrings = strings.size();
+  vector<uint64_t> offs;
+  offs.reserve(strings.size() + 1);
+  uint64_t off = 0;
+  for (auto &s : strings) {
+    offs.push_back(off);
+    off += s.size() + 1;
+  }
+  offs.push_back(off);
+  os.write((const char *)offs.data(), offs.size() * sizeof(uint64_t));
+  for (auto &s : strings) os.write(s.c_str(), s.size() + 1);
+  pos += offs.size() * sizeof(uint64_t) + off;
+
+  align();
+  memcpy(t.magic, MAGIC, sizeof(MAGIC));
+  os.write((const char *)&t, sizeof(t));
+  pos += sizeof(t);
+  os.flush();
+  return bool(os);
+}
+
+bool bincodeWriter::write(const code &c, ostream &os) {
+  bincodeWriter w(os);
+  for (auto &s : c.get_subroutines()) w.add_subroutine(s);
+  return w.finish();
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'bincodeReader'
+
+bincodeReader::bincodeReader() :
+  data(nullptr), size(0), mapped(false), records(nullptr), nrecords(0), subs(nullptr), nsubs(0),
+  aux(nullptr), naux(0), stroffs(nullptr), strchars(nullptr), nstrings(0) {}
+
+bincodeReader::~bincodeReader() { close(); }
+
+void bincodeReader::close() {
+  if (mapped) munmap((void *)data, size);
+  data = nullptr;
+  size = 0;
+  mapped = false;
+}
+
+bool bincodeReader::fail(const string &msg) {
+  error = msg;
+  close();
+  return false;
+}
+
+const string & bincodeReader::get_error() const { return error; }
+
+bool bincodeReader::is_bincode(const char *data, size_t size) {
+  return size >= sizeof(MAGIC) and memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+// true if [off, off+n*sz) lies inside a file of the given size, and
+// off is aligned
+static bool inside(uint64_t off, uint64_t n, uint64_t sz, uint64_t size) {
+  return off % 8 == 0 and off <= size and n <= (size - off) / sz;
+}
+
+bool bincodeReader::open(const string &path) {
+  close();
+  error.clear();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return fail("can not open " + path);
+  struct stat st;
+  if (fstat(fd, &st) < 0) { ::close(fd); return fail("can not open " + path); }
+  size = st.st_size;
+  if (size < HEADER_SIZE + sizeof(filetrailer)) {
+    ::close(fd);
+    size = 0;
+    return fail(path + " is not a binary t-code file");
+  }
+  void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) { size = 0; return fail("can not map " + path); }
+  data = (const char *)p;
+  mapped = true;
+  return check(path);
+}
+
+bool bincodeReader::open(const char *buf, size_t n, const string &name) {
+  close();
+  error.clear();
+
+  if (n < HEADER_SIZE + sizeof(filetrailer) or (uintptr_t)buf % 8 != 0)
+    return fail(name + " is not a binary t-code file");
+  data = buf;
+  size = n;
+  return check(name);
+}
+
+// validate the header, the trailer and the sections of the file in
+// 'data' (of at least HEADER_SIZE + sizeof(filetrailer) bytes)
+bool bincodeReader::check(const string &path) {
+  // header and trailer
+  const fileheader *h = (const fileheader *)data;
+  const filetrailer *t = (const filetrailer *)(data + size - sizeof(filetrailer));
+  if (memcmp(h->magic, MAGIC, sizeof(MAGIC)) or memcmp(t->magic, MAGIC, sizeof(MAGIC)))
+    return fail(path + " is not a binary t-code file");
+  if (h->version != BINCODE_VERSION)
+    return fail(path + ": unsupported version " + to_string(h->version));
+
+  // sections
+  uint64_t body = size - sizeof(filetrailer);
+  if (t->nstrings >= body or
+      not inside(t->records, t->nrecords, sizeof(record), body) or
+      not inside(t->subs, t->nsubs, sizeof(subentry), body) or
+      not inside(t->aux, t->naux, sizeof(uint32_t), body) or
+      not inside(t->strings, t->nstrings + 1, sizeof(uint64_t), body))
+    return fail(path + ": corrupted file (sections)");
+  records  = (const record *)(data + t->records);
+  nrecords = t->nrecords;
+  subs     = (const subentry *)(data + t->subs);
+  nsubs    = t->nsubs;
+  aux      = (const uint32_t *)(data + t->aux);
+  naux     = t->naux;
+  stroffs  = (const uint64_t *)(data + t->strings);
+  nstrings = t->nstrings;
+  strchars = (const char *)(stroffs + nstrings + 1);
+
+  // string table: increasing offsets, NUL-terminated strings
+  uint64_t nchars = body - (strchars - data);
+  if (stroffs[0] != 0 or stroffs[nstrings] > nchars)
+    return fail(path + ": corrupted file (strings)");
+  for (uint64_t i = 0; i < nstrings; ++i)
+    if (stroffs[i] >= stroffs[i+1] or strchars[stroffs[i+1]-1] != '\0')
+      return fail(path + ": corrupted file (strings)");
+
+  // subroutines and their records
+  for (uint64_t s = 0; s < nsubs; ++s) {
+    const subentry &e = subs[s];
+    uint64_t naux_s = uint64_t(e.nparams) + 2*uint64_t(e.nvars) + 2*uint64_t(e.nlabels);
+    if (e.name >= nstrings or
+        e.first_record > nrecords or e.nrecords > nrecords - e.first_record or
+        e.first_aux > naux or naux_s > naux - e.first_aux)
+      return fail(path + ": corrupted file (subroutine " + to_string(s) + ")");
+    const uint32_t *a = aux + e.first_aux;
+    for (uint32_t i = 0; i < e.nparams; ++i, ++a)
+      if (*a >= nstrings) return fail(path + ": corrupted file (params)");
+    for (uint32_t i = 0; i < e.nvars; ++i, a += 2)
+      if (a[0] >= nstrings) return fail(path + ": corrupted file (vars)");
+    for (uint32_t i = 0; i < e.nlabels; ++i, a += 2)
+      if (a[0] >= nstrings or a[1] >= e.nrecords)
+        return fail(path + ": corrupted file (labels)");
+  }
+  for (uint64_t r = 0; r < nrecords; ++r) {
+    const record &rec = records[r];
+    if (rec.oper >= instruction::_INVALID)
+      return fail(path + ": corrupted file (instruction " + to_string(r) + ")");
+    for (uint32_t a : {rec.arg1, rec.arg2, rec.arg3})
+      if ((a >> KIND_SHIFT) == operand::_NAME and (a & PAYLOAD_MASK) >= nstrings)
+        return fail(path + ": corrupted file (instruction " + to_string(r) + ")");
+  }
+  return true;
+}
+
+size_t bincodeReader::get_number_of_subroutines() const { return nsubs; }
+size_t bincodeReader::get_number_of_strings() const { return nstrings; }
+const char * bincodeReader::get_string(uint32_t id) const { return strchars + stroffs[id]; }
+const char * bincodeReader::get_name(size_t sub) const { return get_string(subs[sub].name); }
+size_t bincodeReader::get_number_of_params(size_t sub) const { return subs[sub].nparams; }
+size_t bincodeReader::get_number_of_vars(size_t sub) const { return subs[sub].nvars; }
+size_t bincodeReader::get_number_of_labels(size_t sub) const { return subs[sub].nlabels; }
+
+const bincodeReader::record * bincodeReader::get_records(size_t sub, size_t &n) const {
+  n = subs[sub].nrecords;
+  return records + subs[sub].first_record;
+}
+
+long bincodeReader::get_label_pc(size_t sub, const string &label) const {
+  const subentry &e = subs[sub];
+  const uint32_t *l = aux + e.first_aux + e.nparams + 2*e.nvars;
+  size_t lo = 0, hi = e.nlabels;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    int cmp = strcmp(get_string(l[2*mid]), label.c_str());
+    if (cmp == 0) return l[2*mid+1];
+    if (cmp < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return -1;
+}
+
+operand bincodeReader::arg(uint32_t a) const {
+  operand::Kind k = operand::Kind(a >> KIND_SHIFT);
+  if (k == operand::_NAME) return operand(get_string(a & PAYLOAD_MASK));
+  if (k == operand::_NONE) return operand();
+  return operand(k, a & PAYLOAD_MASK);
+}
+
+code bincodeReader::to_code() const {
+  code c;
+  // operands of each string of the file, built once
+  vector<operand> names;
+  names.reserve(nstrings);
+  for (uint64_t i = 0; i < nstrings; ++i) names.push_back(operand(get_string(i)));
+
+  for (uint64_t s = 0; s < nsubs; ++s) {
+    const subentry &e = subs[s];
+    subroutine sub(get_string(e.name));
+    const uint32_t *a = aux + e.first_aux;
+    for (uint32_t i = 0; i < e.nparams; ++i, ++a) sub.add_param(get_string(*a));
+    for (uint32_t i = 0; i < e.nvars; ++i, a += 2) sub.add_var(get_string(a[0]), a[1]);
+
+    instructionList instrs;
+    instrs.reserve(e.nrecords);
+    const record *r = records + e.first_record;
+    for (uint64_t i = 0; i < e.nrecords; ++i, ++r) {
+      operand ops[3];
+      const uint32_t args[3] = {r->arg1, r->arg2, r->arg3};
+      for (int k = 0; k < 3; ++k)
+        ops[k] = ((args[k] >> KIND_SHIFT) == operand::_NAME) ? names[args[k] & PAYLOAD_MASK]
+                                                            : arg(args[k]);
+      instrs.push_back(instruction(instruction::Operation(r->oper), ops[0], ops[1], ops[2]));
+    }
+    sub.set_instructions(std::move(instrs));
+    c.add_subroutine(std::move(sub));
+  }
+  return c;
+}
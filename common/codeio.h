@@ -0,0 +1,172 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    codeio - Reading and writing t-code for
+//             the Asl programming language
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+
+//////////////////////////////////////////////////////////////////////
+// Text t-code (.t files, as written by code::dump and read by the
+// tvm). Parses the whole stream into 'c'. Returns false (and a
+// message with the line number in 'error') if the text is not
+// valid t-code.
+
+bool parse_code(std::istream & is, code & c, std::string & error);
+
+// Same, for the text in a buffer (e.g. a mapped file), that is not
+// copied.
+bool parse_code(const char * data, std::size_t size, code & c, std::string & error);
+
+
+//////////////////////////////////////////////////////////////////////
+// Binary t-code. A file has the following layout (all integers are
+// in the native (little-endian) layout, and all sections are 8-byte
+// aligned):
+//
+//   header      magic "TCODEBIN", version
+//   records     the instructions of all the subroutines, one after
+//               the other, as fixed-width records (opcode + 3 args)
+//   subroutines one fixed-width entry per subroutine: name, where
+//               its records, params, vars and labels are
+//   aux         the params (name), vars (name, size) and labels
+//               (name, pc) of every subroutine
+//   strings     the string table (offsets + NUL-terminated chars)
+//   trailer     offsets and sizes of the sections above, magic
+//
+// An argument is encoded like an 'operand': 2 bits of kind and 30
+// bits of value, except that the value of a name is its index in the
+// string table of the file. The records are written while the
+// subroutines are generated; the rest is written by finish(), so the
+// whole program never needs to be in memory.
+
+// current version of the binary format
+const uint32_t BINCODE_VERSION = 1;
+
+class bincodeWriter {
+public:
+  // the stream must be opened in binary mode
+  bincodeWriter(std::ostream & os);
+
+  // write the instructions of a subroutine (and remember its index)
+  void add_subroutine(const subroutine & s);
+  // write the index, the string table and the trailer. Returns false
+  // if the stream failed at some point
+  bool finish();
+
+  // write a whole code
+  static bool write(const code & c, std::ostream & os);
+
+private:
+  struct subentry {
+    uint32_t name, nparams, nvars, nlabels;
+    uint64_t first_record, nrecords, first_aux;
+  };
+
+  uint32_t str(const std::string & s);
+  uint32_t arg(const operand & o);
+  void     align();
+
+  std::ostream                              & os;
+  uint64_t                                    pos;
+  uint64_t                                    nrecords;
+  std::vector<subentry>                       subs;
+  std::vector<uint32_t>                       aux;
+  std::vector<std::string>                    strings;
+  std::unordered_map<std::string, uint32_t>   stringIdx;
+};
+
+
+// Read-only view of a binary t-code file, mapped in memory with mmap
+// (nothing is copied: the accessors point into the mapped file)
+class bincodeReader {
+public:
+  // an instruction record
+  struct record {
+    uint32_t oper;
+    uint32_t arg1, arg2, arg3;
+  };
+
+  bincodeReader();
+  ~bincodeReader();
+  bincodeReader(const bincodeReader &) = delete;
+  bincodeReader & operator=(const bincodeReader &) = delete;
+
+  // true if the file (in memory) starts with the magic of binary
+  // t-code
+  static bool is_bincode(const char * data, std::size_t size);
+
+  // map and check a file. Returns false (see get_error) if the file
+  // can not be mapped or it is not valid binary t-code
+  bool open(const std::string & path);
+  // check a file that is already in memory (named 'name' in the
+  // errors). The buffer is not copied nor unmapped, so it must live
+  // as long as the reader, and be 8-byte aligned
+  bool open(const char * data, std::size_t size, const std::string & name);
+  const std::string & get_error() const;
+
+  // zero-copy accessors
+  std::size_t    get_number_of_subroutines()           const;
+  const char *   get_name(std::size_t sub)              const;
+  const record * get_records(std::size_t sub, std::size_t & n) const;
+  std::size_t    get_number_of_params(std::size_t sub)  const;
+  std::size_t    get_number_of_vars(std::size_t sub)    const;
+  std::size_t    get_number_of_labels(std::size_t sub)  const;
+  // program counter of a label, or -1 if it is not defined
+  long           get_label_pc(std::size_t sub, const std::string & label) const;
+  const char *   get_string(uint32_t id)                const;
+  std::size_t    get_number_of_strings()                const;
+
+  // build the equivalent 'code' object
+  code to_code() const;
+
+private:
+  struct subentry {
+    uint32_t name, nparams, nvars, nlabels;
+    uint64_t first_record, nrecords, first_aux;
+  };
+
+  bool fail(const std::string & msg);
+  bool check(const std::string & name);
+  void close();
+  operand arg(uint32_t a) const;
+
+  const char     * data;
+  std::size_t      size;
+  bool             mapped;   // data was mapped by open(path)
+  const record   * records;
+  uint64_t         nrecords;
+  const subentry * subs;
+  uint64_t         nsubs;
+  const uint32_t * aux;
+  uint64_t         naux;
+  const uint64_t * stroffs;
+  const char     * strchars;
+  uint64_t         nstrings;
+  std::string      error;
+};
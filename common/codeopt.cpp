@@ -0,0 +1,854 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    codeopt - Optimizations of the t-code of a subroutine
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "codeopt.h"
+#include "codecfg.h"
+
+#include <unordered_map>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional> // greater
+#include <string>
+#include <cstdint>
+#include <cstdio>     // snprintf
+#include <cstdlib>    // strtof, strtoll
+#include <cmath>      // isfinite, signbit
+#include <chrono>
+
+using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+// Helpers
+
+// true if the instruction writes its first argument (a temporal or
+// a variable; XLOAD and CLOAD write memory through it instead)
+static bool writesArg1(const instruction & i) {
+  switch (i.oper) {
+  case instruction::_POP :
+    return not i.arg1.empty();
+  case instruction::_ADD :  case instruction::_SUB :  case instruction::_MUL :
+  case instruction::_DIV :  case instruction::_EQ :   case instruction::_LT :
+  case instruction::_LE :   case instruction::_AND :  case instruction::_OR :
+  case instruction::_FADD : case instruction::_FSUB : case instruction::_FMUL :
+  case instruction::_FDIV : case instruction::_FEQ :  case instruction::_FLT :
+  case instruction::_FLE :  case instruction::_NEG :  case instruction::_NOT :
+  case instruction::_FNEG : case instruction::_FLOAT :
+  case instruction::_LOAD : case instruction::_ILOAD : case instruction::_CHLOAD :
+  case instruction::_FLOAD : case instruction::_LOADX : case instruction::_ALOAD :
+  case instruction::_LOADC : case instruction::_READI : case instruction::_READF :
+  case instruction::_READC :
+    return true;
+  default :
+    return false;
+  }
+}
+
+// value of a character constant, as written by CHLOAD ("a", "\t", ...)
+static int32_t charValue(const string & s) {
+  if (s.size() < 2 or s[0] != '\\') return s.empty() ? 0 : (unsigned char)s[0];
+  switch (s[1]) {
+  case 'n' : return '\n';
+  case 't' : return '\t';
+  case '0' : return '\0';
+  default  : return (unsigned char)s[1];   // \\ \' \"
+  }
+}
+
+// value of an integer constant
+static int32_t intValue(const operand & o) {
+  if (o.kind() == operand::_INT) return int32_t(o.value());
+  return int32_t(strtoll(o.str().c_str(), nullptr, 10));
+}
+
+// 32-bit integer arithmetic wraps around, as in the tvm
+static inline int32_t wrap(uint32_t v) { return int32_t(v); }
+
+
+////////////////////////////////////////////////////////////////////
+// Constant folding and propagation
+
+namespace {
+
+// a known value: integers (and booleans), characters and floats. The
+// text of a character is the one of its CHLOAD; the one of a float
+// is its literal, or empty if it has been computed
+struct constant {
+  enum Kind {INT, CHAR, FLOAT} kind;
+  int32_t i;
+  float   f;
+  operand text;
+
+  static constant integer(int32_t v) { return constant{INT, v, 0, operand()}; }
+  static constant real(float v) { return constant{FLOAT, 0, v, operand()}; }
+};
+
+}  // namespace
+
+// the shortest text without exponent (as the tvm reads them) of a
+// float constant, if it can be written: finite and not negative
+static bool floatText(float f, string & text) {
+  if (not std::isfinite(f) or std::signbit(f)) return false;
+  char buf[128];
+  for (int digits = 1; digits <= 60; ++digits) {
+    snprintf(buf, sizeof(buf), "%.*f", digits, f);
+    if (strtof(buf, nullptr) == f) {
+      text = buf;
+      return true;
+    }
+  }
+  return false;
+}
+
+// the load of the constant 'c' in 'dst', if it can be written
+static bool constantLoad(const operand & dst, const constant & c, instruction & load) {
+  switch (c.kind) {
+  case constant::INT :
+    if (c.i < 0) return false;
+    load = instruction(instruction::_ILOAD, dst, operand(to_string(c.i)));
+    return true;
+  case constant::CHAR :
+    load = instruction(instruction::_CHLOAD, dst, c.text);
+    return true;
+  case constant::FLOAT : {
+    if (not c.text.empty()) {
+      load = instruction(instruction::_FLOAD, dst, c.text);
+      return true;
+    }
+    string text;
+    if (not floatText(c.f, text)) return false;
+    load = instruction(instruction::_FLOAD, dst, operand(text));
+    return true;
+  }
+  }
+  return false;
+}
+
+// the result of the operation 'i' on the known operands 'a' (and
+// 'b'). Returns false if it can not (or must not) be computed now
+static bool evaluate(const instruction & i, const constant & a, const constant & b, constant & r) {
+  switch (i.oper) {
+  case instruction::_ADD : r = constant::integer(wrap(uint32_t(a.i) + uint32_t(b.i))); return true;
+  case instruction::_SUB : r = constant::integer(wrap(uint32_t(a.i) - uint32_t(b.i))); return true;
+  case instruction::_MUL : r = constant::integer(wrap(uint32_t(a.i) * uint32_t(b.i))); return true;
+  case instruction::_DIV :
+    // the errors are for the run time to report
+    if (b.i == 0 or (b.i == -1 and a.i == INT32_MIN)) return false;
+    r = constant::integer(a.i / b.i);
+    return true;
+  case instruction::_EQ  : r = constant::integer(a.i == b.i); return true;
+  case instruction::_LT  : r = constant::integer(a.i <  b.i); return true;
+  case instruction::_LE  : r = constant::integer(a.i <= b.i); return true;
+  case instruction::_AND : r = constant::integer(a.i and b.i); return true;
+  case instruction::_OR  : r = constant::integer(a.i or  b.i); return true;
+  case instruction::_NOT : r = constant::integer(not a.i); return true;
+  case instruction::_NEG : r = constant::integer(wrap(0u - uint32_t(a.i))); return true;
+  case instruction::_FADD : r = constant::real(a.f + b.f); break;
+  case instruction::_FSUB : r = constant::real(a.f - b.f); break;
+  case instruction::_FMUL : r = constant::real(a.f * b.f); break;
+  case instruction::_FDIV : r = constant::real(a.f / b.f); break;
+  case instruction::_FNEG : r = constant::real(- a.f); break;
+  case instruction::_FLOAT : r = constant::real(float(a.i)); break;
+  case instruction::_FEQ : r = constant::integer(a.f == b.f); return true;
+  case instruction::_FLT : r = constant::integer(a.f <  b.f); return true;
+  case instruction::_FLE : r = constant::integer(a.f <= b.f); return true;
+  default : return false;
+  }
+  // infinities and NaNs are not followed
+  return std::isfinite(r.f);
+}
+
+bool fold_constants(subroutine & s) {
+  const instructionList & instrs = s.get_instructions();
+  instructionList result;
+  result.reserve(instrs.size());
+  // the known constants in the current basic block, by operand
+  unordered_map<uint32_t, constant> known;
+  auto find = [&](const operand & o, constant & c) {
+    auto f = known.find(o.handle());
+    if (f == known.end()) return false;
+    c = f->second;
+    return true;
+  };
+  bool changed = false;
+
+  for (const instruction & i : instrs) {
+    constant a, b, r;
+    instruction load(instruction::_NOOP);
+    switch (i.oper) {
+    case instruction::_LABEL :
+      // other blocks may jump here
+      known.clear();
+      break;
+    case instruction::_ILOAD :
+      known[i.arg1.handle()] = constant::integer(intValue(i.arg2));
+      break;
+    case instruction::_CHLOAD :
+      known[i.arg1.handle()] = constant{constant::CHAR, charValue(i.arg2.str()), 0, i.arg2};
+      break;
+    case instruction::_FLOAD :
+      known[i.arg1.handle()] = constant{constant::FLOAT, 0, strtof(i.arg2.str().c_str(), nullptr), i.arg2};
+      break;
+    case instruction::_LOAD :
+      // booleans are loaded as "x = 1" / "x = 0"
+      if (i.arg2.kind() == operand::_INT)
+        known[i.arg1.handle()] = constant::integer(intValue(i.arg2));
+      else if (find(i.arg2, a)) {
+        known[i.arg1.handle()] = a;
+        if (constantLoad(i.arg1, a, load)) {
+          result.push_back(load);
+          changed = true;
+          continue;
+        }
+      }
+      else
+        known.erase(i.arg1.handle());
+      break;
+    case instruction::_FJUMP :
+      if (find(i.arg1, a)) {
+        changed = true;
+        if (a.i) continue;   // never jumps
+        result.push_back(instruction(instruction::_UJUMP, i.arg2));
+        continue;
+      }
+      break;
+    case instruction::_ADD :  case instruction::_SUB :  case instruction::_MUL :
+    case instruction::_DIV :  case instruction::_EQ :   case instruction::_LT :
+    case instruction::_LE :   case instruction::_AND :  case instruction::_OR :
+    case instruction::_FADD : case instruction::_FSUB : case instruction::_FMUL :
+    case instruction::_FDIV : case instruction::_FEQ :  case instruction::_FLT :
+    case instruction::_FLE :
+      if (find(i.arg2, a) and find(i.arg3, b) and evaluate(i, a, b, r)) {
+        known[i.arg1.handle()] = r;
+        if (constantLoad(i.arg1, r, load)) {
+          result.push_back(load);
+          changed = true;
+          continue;
+        }
+      }
+      else
+        known.erase(i.arg1.handle());
+      break;
+    case instruction::_NOT : case instruction::_NEG :
+    case instruction::_FNEG : case instruction::_FLOAT :
+      if (find(i.arg2, a) and evaluate(i, a, a, r)) {
+        known[i.arg1.handle()] = r;
+        if (constantLoad(i.arg1, r, load)) {
+          result.push_back(load);
+          changed = true;
+          continue;
+        }
+      }
+      else
+        known.erase(i.arg1.handle());
+      break;
+    default :
+      if (writesArg1(i)) known.erase(i.arg1.handle());
+      // an array written by element is no longer a known scalar
+      else if (i.oper == instruction::_XLOAD or i.oper == instruction::_CLOAD)
+        known.erase(i.arg1.handle());
+      break;
+    }
+    result.push_back(i);
+  }
+
+  if (changed) s.set_instructions(std::move(result));
+  return changed;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Copy propagation
+
+// call 'f' with each argument that the instruction reads: as a value
+// ('address' false) or as the array or pointer it accesses (true)
+template <typename Instruction, typename F>
+static void forEachUse(Instruction & i, F f) {
+  switch (i.oper) {
+  case instruction::_FJUMP :
+  case instruction::_WRITEI : case instruction::_WRITEF : case instruction::_WRITEC :
+    f(i.arg1, false);
+    break;
+  case instruction::_PUSH :
+    if (not i.arg1.empty()) f(i.arg1, false);
+    break;
+  case instruction::_ADD :  case instruction::_SUB :  case instruction::_MUL :
+  case instruction::_DIV :  case instruction::_EQ :   case instruction::_LT :
+  case instruction::_LE :   case instruction::_AND :  case instruction::_OR :
+  case instruction::_FADD : case instruction::_FSUB : case instruction::_FMUL :
+  case instruction::_FDIV : case instruction::_FEQ :  case instruction::_FLT :
+  case instruction::_FLE :
+    f(i.arg2, false);
+    f(i.arg3, false);
+    break;
+  case instruction::_NOT :  case instruction::_NEG :  case instruction::_FNEG :
+  case instruction::_FLOAT : case instruction::_LOAD :
+    f(i.arg2, false);
+    break;
+  case instruction::_XLOAD :
+    f(i.arg1, true);
+    f(i.arg2, false);
+    f(i.arg3, false);
+    break;
+  case instruction::_LOADX :
+    f(i.arg2, true);
+    f(i.arg3, false);
+    break;
+  case instruction::_LOADC :
+    f(i.arg2, true);
+    break;
+  case instruction::_CLOAD :
+    f(i.arg1, true);
+    f(i.arg2, false);
+    break;
+  default :
+    // ALOAD takes the address of its variable, it does not read it
+    break;
+  }
+}
+
+// the number of reads of each temporal in 'instrs'
+static unordered_map<uint32_t, unsigned> temporalUses(const instructionList & instrs) {
+  unordered_map<uint32_t, unsigned> uses;
+  for (const instruction & i : instrs)
+    forEachUse(i, [&](const operand & o, bool) {
+        if (o.kind() == operand::_TEMP) ++uses[o.handle()];
+      });
+  return uses;
+}
+
+bool propagate_copies(subroutine & s) {
+  instructionList instrs = s.get_instructions();
+  bool changed = false;
+
+  // the temporals that are a copy of another operand (or hold the
+  // same constant as another temporal) in the current basic block.
+  // Each one remembers the definition of its source it copied: it is
+  // no longer valid once the source is written again
+  struct copy {
+    operand  source;
+    unsigned version;
+  };
+  unordered_map<uint32_t, copy> copies;
+  unordered_map<uint32_t, unsigned> version;
+  // the temporal holding each constant (by instruction and text)
+  unordered_map<uint64_t, copy> constants;
+  auto valid = [&](const copy & c) {
+    return version[c.source.handle()] == c.version;
+  };
+
+  for (instruction & i : instrs) {
+    if (i.oper == instruction::_LABEL) {
+      // other blocks may jump here
+      copies.clear();
+      constants.clear();
+      continue;
+    }
+    forEachUse(i, [&](operand & o, bool address) {
+        if (o.kind() != operand::_TEMP) return;
+        auto f = copies.find(o.handle());
+        if (f == copies.end() or not valid(f->second)) return;
+        // arrays of the subroutine are accessed by name, the ones
+        // received as parameters through a temporal with their address
+        if (address and f->second.source.kind() != operand::_TEMP) return;
+        o = f->second.source;
+        changed = true;
+      });
+    if (not writesArg1(i)) continue;
+
+    uint32_t dst = i.arg1.handle();
+    copies.erase(dst);
+    ++version[dst];
+    if (i.arg1.kind() != operand::_TEMP) continue;
+    if (i.oper == instruction::_LOAD and i.arg1 != i.arg2 and
+        (i.arg2.kind() == operand::_TEMP or i.arg2.kind() == operand::_NAME))
+      copies[dst] = copy{i.arg2, version[i.arg2.handle()]};
+    else if (i.oper == instruction::_ILOAD or i.oper == instruction::_FLOAD or
+             i.oper == instruction::_CHLOAD) {
+      uint64_t key = (uint64_t(i.oper) << 32) | i.arg2.handle();
+      auto f = constants.find(key);
+      if (f != constants.end() and valid(f->second))
+        copies[dst] = f->second;
+      else
+        constants[key] = copy{i.arg1, version[dst]};
+    }
+  }
+
+  // a temporal computed only to be copied in the next instruction is
+  // computed there directly ("%4 = r - %3; r = %4" -> "r = r - %3")
+  unordered_map<uint32_t, unsigned> uses = temporalUses(instrs);
+  instructionList result;
+  result.reserve(instrs.size());
+  for (size_t k = 0; k < instrs.size(); ++k) {
+    instruction & i = instrs[k];
+    if (k + 1 < instrs.size() and writesArg1(i) and i.arg1.kind() == operand::_TEMP) {
+      const instruction & next = instrs[k + 1];
+      if (next.oper == instruction::_LOAD and next.arg2 == i.arg1 and
+          next.arg1 != i.arg1 and uses[i.arg1.handle()] == 1) {
+        i.arg1 = next.arg1;
+        result.push_back(std::move(i));
+        ++k;
+        changed = true;
+        continue;
+      }
+    }
+    result.push_back(std::move(i));
+  }
+
+  if (changed) s.set_instructions(std::move(result));
+  return changed;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Dead code elimination
+
+// true if the instruction can be removed when its result is not used
+// (it has no other effect, and it can not stop the program)
+static bool removable(const instruction & i) {
+  switch (i.oper) {
+  case instruction::_DIV :  case instruction::_FDIV :
+  case instruction::_LOADX : case instruction::_LOADC :
+  case instruction::_READI : case instruction::_READF : case instruction::_READC :
+  case instruction::_POP :
+    return false;
+  default :
+    return writesArg1(i);
+  }
+}
+
+bool remove_dead_code(subroutine & s) {
+  const instructionList & instrs = s.get_instructions();
+  unordered_map<uint32_t, unsigned> uses = temporalUses(instrs);
+
+  // removing an instruction may leave the ones computing its operands
+  // unused: going backwards they are found in the same sweep (another
+  // one is needed only for the temporals used before a loop back)
+  vector<bool> dead(instrs.size(), false);
+  bool changed = false, sweep = true;
+  while (sweep) {
+    sweep = false;
+    for (size_t k = instrs.size(); k-- > 0; ) {
+      const instruction & i = instrs[k];
+      if (dead[k] or i.arg1.kind() != operand::_TEMP or uses[i.arg1.handle()] != 0 or
+          not removable(i))
+        continue;
+      dead[k] = true;
+      forEachUse(i, [&](const operand & o, bool) {
+          if (o.kind() == operand::_TEMP) --uses[o.handle()];
+        });
+      changed = sweep = true;
+    }
+  }
+  // a result that nobody reads is popped without keeping it
+  auto unusedPop = [&](const instruction & i) {
+    return i.oper == instruction::_POP and i.arg1.kind() == operand::_TEMP and
+           uses[i.arg1.handle()] == 0;
+  };
+  for (const instruction & i : instrs)
+    if (unusedPop(i)) changed = true;
+  if (not changed) return false;
+
+  instructionList result;
+  result.reserve(instrs.size());
+  for (size_t k = 0; k < instrs.size(); ++k) {
+    if (dead[k]) continue;
+    if (unusedPop(instrs[k])) result.push_back(instruction::POP());
+    else                      result.push_back(instrs[k]);
+  }
+  s.set_instructions(std::move(result));
+  return true;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Fusion of negated comparisons
+
+bool fuse_branches(subroutine & s) {
+  const instructionList & instrs = s.get_instructions();
+  unordered_map<uint32_t, unsigned> uses = temporalUses(instrs);
+  instructionList result;
+  result.reserve(instrs.size());
+  bool changed = false;
+
+  for (size_t k = 0; k < instrs.size(); ++k) {
+    const instruction & i = instrs[k];
+    if (k + 1 < instrs.size() and i.arg1.kind() == operand::_TEMP and
+        (i.oper == instruction::_EQ or i.oper == instruction::_LT or i.oper == instruction::_LE)) {
+      const instruction & neg = instrs[k + 1];
+      // the comparison is only read by a NOT that follows it
+      bool negated = neg.oper == instruction::_NOT and neg.arg2 == i.arg1 and
+                     neg.arg1.kind() == operand::_TEMP and
+                     (neg.arg1 == i.arg1 or uses[i.arg1.handle()] == 1);
+      if (negated and i.oper != instruction::_EQ) {
+        // not (a < b) = b <= a, not (a <= b) = b < a
+        result.push_back(instruction(i.oper == instruction::_LT ? instruction::_LE : instruction::_LT,
+                                     neg.arg1, i.arg3, i.arg2));
+        ++k;
+        changed = true;
+        continue;
+      }
+      // a != b only read by a branch: it does not jump if a - b is
+      // not zero
+      if (negated and k + 2 < instrs.size() and
+          instrs[k + 2].oper == instruction::_FJUMP and instrs[k + 2].arg1 == neg.arg1 and
+          uses[neg.arg1.handle()] == (neg.arg1 == i.arg1 ? 2u : 1u)) {
+        result.push_back(instruction(instruction::_SUB, neg.arg1, i.arg2, i.arg3));
+        ++k;
+        changed = true;
+        continue;
+      }
+    }
+    result.push_back(i);
+  }
+
+  if (changed) s.set_instructions(std::move(result));
+  return changed;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Renaming of temporals
+
+namespace {
+
+// the live range of a temporal: from its first to its last point,
+// where each instruction k has two points: 2k when it reads its
+// operands and 2k+1 when it writes its result
+struct range {
+  size_t start, end;
+  uint32_t handle;
+};
+
+}  // namespace
+
+bool rename_temporals(subroutine & s) {
+  instructionList instrs = s.get_instructions();
+  flowGraph g(instrs);
+
+  // the first and last points of each temporal in the code
+  unordered_map<uint32_t, range> ranges;
+  auto touch = [&](uint32_t handle, size_t point) {
+    auto f = ranges.find(handle);
+    if (f == ranges.end()) ranges.emplace(handle, range{point, point, handle});
+    else {
+      f->second.start = std::min(f->second.start, point);
+      f->second.end = std::max(f->second.end, point);
+    }
+  };
+  // the blocks where each temporal is read before being written (it
+  // is live at their start) and the ones where it is written
+  unordered_map<uint32_t, vector<size_t>> exposed, written;
+  for (size_t b = 0; b < g.num_blocks(); ++b) {
+    for (size_t k = g.get_block(b).first; k <= g.get_block(b).last; ++k) {
+      const instruction & i = instrs[k];
+      forEachUse(i, [&](const operand & o, bool) {
+          if (o.kind() != operand::_TEMP) return;
+          touch(o.handle(), 2*k);
+          auto w = written.find(o.handle());
+          if (w != written.end() and w->second.back() == b) return;
+          vector<size_t> & e = exposed[o.handle()];
+          if (e.empty() or e.back() != b) e.push_back(b);
+        });
+      if (writesArg1(i) and i.arg1.kind() == operand::_TEMP) {
+        touch(i.arg1.handle(), 2*k + 1);
+        vector<size_t> & w = written[i.arg1.handle()];
+        if (w.empty() or w.back() != b) w.push_back(b);
+      }
+    }
+  }
+  if (ranges.empty()) return false;
+
+  // the liveness of each of them, going backwards from the blocks
+  // where it is live at the start to the ones that write it: it
+  // extends its range to the start (or end) of each block where it is
+  // live at the start (or end). Few temporals live across blocks, and
+  // not for long, so this is faster than solving for all of them at
+  // once with solve_dataflow (a set of bits for each temporal and block)
+  size_t nblocks = g.num_blocks();
+  vector<size_t> liveIn(nblocks, 0), liveOut(nblocks, 0), writes(nblocks, 0);
+  size_t stamp = 0;
+  vector<size_t> pending;
+  for (auto & e : exposed) {
+    ++stamp;
+    auto w = written.find(e.first);
+    if (w != written.end())
+      for (size_t b : w->second) writes[b] = stamp;
+    for (size_t b : e.second) {
+      liveIn[b] = stamp;
+      pending.push_back(b);
+    }
+    while (not pending.empty()) {
+      size_t b = pending.back();
+      pending.pop_back();
+      touch(e.first, 2*g.get_block(b).first);
+      for (size_t p : g.get_block(b).preds) {
+        if (liveOut[p] == stamp) continue;
+        liveOut[p] = stamp;
+        touch(e.first, 2*g.get_block(p).last + 1);
+        if (writes[p] != stamp and liveIn[p] != stamp) {
+          liveIn[p] = stamp;
+          pending.push_back(p);
+        }
+      }
+    }
+  }
+
+  // linear scan: the temporals in the order they start, each one in
+  // the lowest slot that is free (whose last temporal has ended)
+  vector<range> order;
+  order.reserve(ranges.size());
+  for (auto & r : ranges) order.push_back(r.second);
+  sort(order.begin(), order.end(), [](const range & a, const range & b) {
+      return a.start < b.start or (a.start == b.start and a.handle < b.handle);
+    });
+  typedef pair<size_t, uint32_t> active;   // (end, slot)
+  priority_queue<active, vector<active>, greater<active>> busy;
+  priority_queue<uint32_t, vector<uint32_t>, greater<uint32_t>> freed;
+  uint32_t slots = 0;
+  unordered_map<uint32_t, operand> names;
+  for (const range & r : order) {
+    while (not busy.empty() and busy.top().first < r.start) {
+      freed.push(busy.top().second);
+      busy.pop();
+    }
+    uint32_t slot;
+    if (freed.empty()) slot = ++slots;
+    else {
+      slot = freed.top();
+      freed.pop();
+    }
+    busy.push(active(r.end, slot));
+    names[r.handle] = operand(operand::_TEMP, slot);
+  }
+
+  bool changed = false;
+  auto rename = [&](operand & o) {
+    if (o.kind() != operand::_TEMP) return;
+    const operand & n = names[o.handle()];
+    if (n != o) {
+      o = n;
+      changed = true;
+    }
+  };
+  for (instruction & i : instrs) {
+    rename(i.arg1);
+    rename(i.arg2);
+    rename(i.arg3);
+  }
+  if (changed) s.set_instructions(std::move(instrs));
+  return changed;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Removal of unreachable code
+
+bool remove_unreachable_code(subroutine & s) {
+  const instructionList & instrs = s.get_instructions();
+  flowGraph g(instrs);
+  vector<bool> reachable = g.get_reachable();
+
+  instructionList result;
+  result.reserve(instrs.size());
+  for (size_t b = 0; b < g.num_blocks(); ++b)
+    if (reachable[b])
+      result.insert(result.end(), instrs.begin() + g.get_block(b).first,
+                    instrs.begin() + g.get_block(b).last + 1);
+  bool changed = result.size() != instrs.size();
+
+  // removing a jump may leave its label unused, and removing a label
+  // may leave a jump just before its target
+  for (bool sweep = true; sweep; ) {
+    sweep = false;
+    unordered_map<uint32_t, unsigned> jumps;
+    for (const instruction & i : result) {
+      if (i.oper == instruction::_UJUMP) ++jumps[i.arg1.handle()];
+      if (i.oper == instruction::_FJUMP) ++jumps[i.arg2.handle()];
+    }
+    instructionList kept;
+    kept.reserve(result.size());
+    for (size_t k = 0; k < result.size(); ++k) {
+      const instruction & i = result[k];
+      if (i.oper == instruction::_LABEL and jumps[i.arg1.handle()] == 0)
+        continue;
+      // the condition of an FJUMP is left for remove_dead_code
+      const operand * target = i.oper == instruction::_UJUMP ? &i.arg1 :
+                               i.oper == instruction::_FJUMP ? &i.arg2 : nullptr;
+      if (target != nullptr and k + 1 < result.size() and
+          result[k + 1].oper == instruction::_LABEL and result[k + 1].arg1 == *target)
+        continue;
+      kept.push_back(i);
+    }
+    if (kept.size() != result.size()) {
+      result.swap(kept);
+      changed = sweep = true;
+    }
+  }
+  if (not changed) return false;
+
+  // the code ended with unreachable blocks (after a loop that never
+  // ends): it still ends with a return
+  if (result.empty() or result.back().oper != instruction::_RETURN)
+    result.push_back(instruction::RETURN());
+  s.set_instructions(std::move(result));
+  return true;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Dead store elimination
+
+bool remove_dead_stores(subroutine & s) {
+  // the scalar variables, numbered: the local variables of one
+  // position whose address is never taken, and the parameters
+  unordered_map<uint32_t, size_t> number;
+  for (const var & v : s.params)
+    number.emplace(operand(v.name).handle(), number.size());
+  size_t nparams = number.size();
+  for (const var & v : s.vars)
+    if (v.size == 1) number.emplace(operand(v.name).handle(), number.size());
+  for (const instruction & i : s.get_instructions()) {
+    forEachUse(i, [&](const operand & o, bool address) {
+        if (address and o.kind() == operand::_NAME) number.erase(o.handle());
+      });
+    if (i.oper == instruction::_ALOAD) number.erase(i.arg2.handle());
+  }
+  if (number.size() == nparams) return false;
+
+  // the variable an instruction reads or writes, or -1
+  auto variable = [&](const operand & o) -> long {
+    if (o.kind() != operand::_NAME) return -1;
+    auto f = number.find(o.handle());
+    return f == number.end() ? -1 : long(f->second);
+  };
+  bool changed = false;
+  for (bool sweep = true; sweep; ) {
+    sweep = false;
+    const instructionList & instrs = s.get_instructions();
+    flowGraph g(instrs);
+
+    // liveness: a variable is live where it may be read before being
+    // written again
+    size_t bits = 0;
+    for (auto & n : number) bits = std::max(bits, n.second + 1);
+    dataflowProblem live(g, bits, dataflowProblem::BACKWARD, dataflowProblem::UNION);
+    for (auto & n : number)
+      if (n.second < nparams) live.boundary.set(n.second);
+    for (size_t b = 0; b < g.num_blocks(); ++b)
+      for (size_t k = g.get_block(b).last + 1; k-- > g.get_block(b).first; ) {
+        const instruction & i = instrs[k];
+        long v = writesArg1(i) ? variable(i.arg1) : -1;
+        if (v >= 0) {
+          live.gen[b].reset(v);
+          live.kill[b].set(v);
+        }
+        forEachUse(i, [&](const operand & o, bool) {
+            long u = variable(o);
+            if (u >= 0) live.gen[b].set(u);
+          });
+      }
+    dataflowSolution sol = solve_dataflow(g, live);
+
+    // the writes to a variable that is dead after them
+    vector<bool> dead(instrs.size(), false);
+    bool found = false;
+    for (size_t b = 0; b < g.num_blocks(); ++b) {
+      bitVector alive = sol.out[b];
+      for (size_t k = g.get_block(b).last + 1; k-- > g.get_block(b).first; ) {
+        const instruction & i = instrs[k];
+        long v = writesArg1(i) ? variable(i.arg1) : -1;
+        if (v >= 0) {
+          if (not alive.test(v) and removable(i)) {
+            dead[k] = found = true;
+            continue;
+          }
+          alive.reset(v);
+        }
+        forEachUse(i, [&](const operand & o, bool) {
+            long u = variable(o);
+            if (u >= 0) alive.set(u);
+          });
+      }
+    }
+    if (not found) break;
+
+    instructionList result;
+    result.reserve(instrs.size());
+    for (size_t k = 0; k < instrs.size(); ++k)
+      if (not dead[k]) result.push_back(instrs[k]);
+    s.set_instructions(std::move(result));
+    // a removed store may have been the only read of another variable
+    changed = sweep = true;
+  }
+  return changed;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Class passManager
+
+passManager::passManager(unsigned level) {
+  if (level == 0) return;
+  add_pass("fold-constants", fold_constants);
+  add_pass("fuse-branches", fuse_branches);
+  add_pass("copy-propagation", propagate_copies);
+  if (level >= 2)
+    add_pass("dead-stores", remove_dead_stores);
+  add_pass("dead-code", remove_dead_code);
+  // once the dead code is gone, more jumps go just to the next label
+  // (and the conditions they leave unused are dead code again)
+  if (level >= 2) {
+    add_pass("unreachable-code", remove_unreachable_code);
+    add_pass("dead-code", remove_dead_code);
+  }
+  add_pass("rename-temporals", rename_temporals);
+}
+
+void passManager::add_pass(const string & name, function<bool(subroutine &)> f) {
+  unique_ptr<pass> p(new pass());
+  p->name = name;
+  p->run = std::move(f);
+  p->ns = p->runs = p->changes = 0;
+  passes.push_back(std::move(p));
+}
+
+bool passManager::empty() const {
+  return passes.empty();
+}
+
+void passManager::run(subroutine & s) {
+  operandPool::scope names(s.get_pool());
+  for (auto & p : passes) {
+    auto start = chrono::steady_clock::now();
+    bool changed = p->run(s);
+    p->ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    ++p->runs;
+    if (changed) ++p->changes;
+  }
+}
+
+vector<passManager::passStats> passManager::get_stats() const {
+  vector<passStats> stats;
+  for (auto & p : passes)
+    stats.push_back(passStats{p->name, p->ns / 1e6, size_t(p->runs), size_t(p->changes)});
+  return stats;
+}
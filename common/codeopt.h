@@ -0,0 +1,160 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    codeopt - Optimizations of the t-code of a subroutine
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+
+//////////////////////////////////////////////////////////////////////
+// Each optimization transforms the instructions of a subroutine in
+// place and returns true if it changed anything. The behaviour of the
+// program is kept as the tvm runs it: integers of 32 bits that wrap
+// around, and floats of single precision.
+//
+// Only temporals and scalar variables hold values: arrays are only
+// accessed through XLOAD, LOADX, LOADC and CLOAD, and the parameters
+// of a call are passed by value (arrays by their address), so a call
+// never changes the temporals and scalars of its caller.
+
+
+//////////////////////////////////////////////////////////////////////
+// Constant folding and propagation. Inside each basic block, it
+// follows the constants loaded in temporals and variables, and
+//   - an operation whose operands are all known constants is replaced
+//     by the load of its result (ILOAD, FLOAD or CHLOAD), when the
+//     result can be written as a t-code constant (not negative, and
+//     a finite float). Integer division by zero (and the overflow of
+//     the division of -2^31 by -1) is left to run time
+//   - a copy of a known constant ("x = %3") loads the constant itself
+//   - a conditional jump on a known condition becomes an
+//     unconditional one, or it is removed
+// The loads that become unused are left for other passes to remove.
+
+bool fold_constants(subroutine & s);
+
+
+//////////////////////////////////////////////////////////////////////
+// Copy propagation. Inside each basic block, the reads of a temporal
+// that is a copy of another temporal or variable ("%2 = x") read the
+// original instead, and a temporal loading a constant that another
+// one already holds is taken as a copy of it. Also, a temporal
+// computed only to be copied by the next instruction is computed
+// there directly ("%4 = r - %3; r = %4" becomes "r = r - %3").
+// The copies that become unused are left for remove_dead_code.
+
+bool propagate_copies(subroutine & s);
+
+
+//////////////////////////////////////////////////////////////////////
+// Dead code elimination: removes the instructions that write a
+// temporal that is never read in the subroutine, as long as they have
+// no other effect (reads, calls) and can not stop the program (integer
+// division, access to memory). The unused results of calls are popped
+// without keeping them.
+
+bool remove_dead_code(subroutine & s);
+
+
+//////////////////////////////////////////////////////////////////////
+// Fusion of negated comparisons. The code of a > b, a >= b and a != b
+// is a comparison followed by a NOT. For integers, the NOT is dropped
+// by comparing the other way round (not (a <= b) becomes b < a), and
+// a != b that is only read by the next conditional jump becomes a - b
+// (the jump is taken when it is 0). Float comparisons are kept, as
+// they are not the opposite of each other when a NaN is compared.
+
+bool fuse_branches(subroutine & s);
+
+
+//////////////////////////////////////////////////////////////////////
+// Renaming of temporals: gives the temporals of the subroutine the
+// names %1, %2, ... so that two of them share a name when they are
+// never live at the same time (from the liveness of the temporals
+// across the basic blocks). The frame of a subroutine holds one slot
+// for each name, so its size is the most temporals ever live at once
+// instead of one for each temporal the code generator created.
+
+bool rename_temporals(subroutine & s);
+
+
+//////////////////////////////////////////////////////////////////////
+// Removal of unreachable code: drops the basic blocks that can not be
+// reached from the start of the subroutine, the jumps to the label
+// that follows them and the labels that no jump goes to (so that the
+// blocks around them become one).
+
+bool remove_unreachable_code(subroutine & s);
+
+
+//////////////////////////////////////////////////////////////////////
+// Dead store elimination: removes the instructions that write a
+// scalar variable that is not read afterwards (from the liveness of
+// the variables, solved over the flow graph), under the same
+// conditions as remove_dead_code. The parameters are taken as read at
+// the end, as the result of a function is returned in one of them,
+// and the variables whose address is taken (arrays) are never dead.
+
+bool remove_dead_stores(subroutine & s);
+
+
+//////////////////////////////////////////////////////////////////////
+// Class passManager: the optimizations of a level (-O1, -O2), run in
+// order on each subroutine. It measures the time of each pass and
+// how many times it changed the code, added up over all the
+// subroutines; run can be called from several threads at once.
+
+class passManager {
+
+public:
+  // Constructor: the passes of the given level (none for level 0)
+  explicit passManager(unsigned level);
+
+  // Add a pass at the end
+  void add_pass(const std::string & name, std::function<bool(subroutine &)> pass);
+  // True if there is no pass to run
+  bool empty() const;
+  // Run all the passes on a subroutine
+  void run(subroutine & s);
+
+  struct passStats {
+    std::string   name;
+    double        ms;
+    std::size_t   runs, changes;
+  };
+  // The time and changes of each pass so far, in their order
+  std::vector<passStats> get_stats() const;
+
+private:
+  struct pass {
+    std::string                        name;
+    std::function<bool(subroutine &)>  run;
+    std::atomic<uint64_t>              ns, runs, changes;
+  };
+  std::vector<std::unique_ptr<pass>>  passes;
+
+};  // class passManager
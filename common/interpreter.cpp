@@ -0,0 +1,375 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    interpreter - In-process execution of t-code for
+//                  the Asl programming language
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "interpreter.h"
+#include "code.h"
+
+#include <unordered_map>
+#include <string>
+#include <cstdlib>    // strtof, strtoll
+
+using namespace std;
+
+
+// Constructor
+interpreter::interpreter(const code & c) :
+  Code{c}, MainSub{0}, Prepared{false}, Executed{0} {
+}
+
+const string & interpreter::getError() const {
+  return Error;
+}
+
+size_t interpreter::getExecutedInstructions() const {
+  return Executed;
+}
+
+bool interpreter::fail(const string & msg) {
+  Error = msg;
+  return false;
+}
+
+bool interpreter::run(istream & in, ostream & out) {
+  Error.clear();
+  Executed = 0;
+  if (not Prepared) {
+    if (not prepare()) return false;
+    Prepared = true;
+  }
+  bool ok = execute(in, out);
+  out.flush();
+  return ok;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Translation of the subroutines
+
+// value of a character constant, as written by CHLOAD ("a", "\t", ...)
+static int32_t charValue(const string & s) {
+  if (s.size() < 2 or s[0] != '\\') return s.empty() ? 0 : (unsigned char)s[0];
+  switch (s[1]) {
+  case 'n' : return '\n';
+  case 't' : return '\t';
+  case '0' : return '\0';
+  default  : return (unsigned char)s[1];   // \\ \' \"
+  }
+}
+
+bool interpreter::prepare() {
+  const vector<subroutine> & subs = Code.get_subroutines();
+  // the handles are the ones of the pool of the code
+  operandPool::scope pool(subs.empty() ? operandPool::get_current() : subs[0].get_pool());
+  // index of each subroutine, by the handle of its name
+  unordered_map<uint32_t, size_t> subIndex;
+  for (size_t i = 0; i < subs.size(); ++i)
+    subIndex[operand(subs[i].get_name()).handle()] = i;
+  auto it = subIndex.find(operand("main").handle());
+  if (it == subIndex.end()) return fail("there is no function main");
+  MainSub = it->second;
+
+  Subs.assign(subs.size(), rsubroutine());
+  for (size_t i = 0; i < subs.size(); ++i)
+    if (not prepare(subs[i], Subs[i], subIndex)) return false;
+  if (Subs[MainSub].nparams != 0) return fail("function main can not have parameters");
+  return true;
+}
+
+bool interpreter::prepare(const subroutine & s, rsubroutine & rs,
+                          const unordered_map<uint32_t, size_t> & subIndex) {
+  const instructionList & instrs = s.get_instructions();
+  rs.name = s.get_name();
+
+  // frame layout: params (before the frame base), local vars, temps
+  struct location { int32_t offset; bool direct; };
+  unordered_map<uint32_t, location> names;
+  rs.nparams = s.params.size();
+  int32_t k = 0;
+  for (auto & p : s.params)
+    names[operand(p.name).handle()] = location{k++ - rs.nparams, false};
+  int32_t size = 0;
+  for (auto & v : s.vars) {
+    names[operand(v.name).handle()] = location{size, true};
+    size += (v.size == 0) ? 1 : v.size;
+  }
+  int32_t ntemps = 0;
+
+  // program counter of each label (labels are not kept)
+  unordered_map<uint32_t, int32_t> labels;
+  int32_t pc = 0;
+  for (auto & i : instrs) {
+    if (i.oper == instruction::_LABEL) labels[i.arg1.handle()] = pc;
+    else ++pc;
+  }
+
+  bool ok = true;
+  string undefined;
+  // frame offset of a variable, parameter or temp
+  auto loc = [&](const operand & o, bool *direct = nullptr) -> int32_t {
+    if (direct) *direct = false;
+    auto f = names.find(o.handle());
+    if (f != names.end()) {
+      if (direct) *direct = f->second.direct;
+      return f->second.offset;
+    }
+    if (o.kind() == operand::_TEMP) {   // temps are created when first seen
+      int32_t off = size + ntemps++;
+      names[o.handle()] = location{off, false};
+      return off;
+    }
+    if (ok) undefined = o.str();
+    ok = false;
+    return 0;
+  };
+  auto target = [&](const operand & o) -> int32_t {
+    auto f = labels.find(o.handle());
+    if (f != labels.end()) return f->second;
+    if (ok) undefined = o.str();
+    ok = false;
+    return 0;
+  };
+  auto callee = [&](const operand & o) -> int32_t {
+    auto f = subIndex.find(o.handle());
+    if (f != subIndex.end()) return f->second;
+    if (ok) undefined = o.str();
+    ok = false;
+    return 0;
+  };
+
+  rs.instrs.reserve(pc);
+  for (auto & i : instrs) {
+    rinstruction r{NOOP, 0, 0, 0};
+    bool direct;
+    switch (i.oper) {
+    case instruction::_LABEL  : continue;
+    case instruction::_UJUMP  : r = {UJUMP, target(i.arg1), 0, 0}; break;
+    case instruction::_FJUMP  : r = {FJUMP, loc(i.arg1), target(i.arg2), 0}; break;
+    case instruction::_PUSH   : r = i.arg1.empty() ? rinstruction{PUSH_EMPTY, 0, 0, 0}
+                                                   : rinstruction{PUSH, loc(i.arg1), 0, 0}; break;
+    case instruction::_POP    : r = i.arg1.empty() ? rinstruction{POP_EMPTY, 0, 0, 0}
+                                                   : rinstruction{POP, loc(i.arg1), 0, 0}; break;
+    case instruction::_CALL   : r = {CALL, callee(i.arg1), 0, 0}; break;
+    case instruction::_RETURN : r = {RETURN, 0, 0, 0}; break;
+    case instruction::_ADD    : r = {ADD,  loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_SUB    : r = {SUB,  loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_MUL    : r = {MUL,  loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_DIV    : r = {DIV,  loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_EQ     : r = {EQ,   loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_LT     : r = {LT,   loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_LE     : r = {LE,   loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_AND    : r = {AND,  loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_OR     : r = {OR,   loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_FADD   : r = {FADD, loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_FSUB   : r = {FSUB, loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_FMUL   : r = {FMUL, loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_FDIV   : r = {FDIV, loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_FEQ    : r = {FEQ,  loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_FLT    : r = {FLT,  loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_FLE    : r = {FLE,  loc(i.arg1), loc(i.arg2), loc(i.arg3)}; break;
+    case instruction::_NOT    : r = {NOT,   loc(i.arg1), loc(i.arg2), 0}; break;
+    case instruction::_NEG    : r = {NEG,   loc(i.arg1), loc(i.arg2), 0}; break;
+    case instruction::_FNEG   : r = {FNEG,  loc(i.arg1), loc(i.arg2), 0}; break;
+    case instruction::_FLOAT  : r = {FLOAT, loc(i.arg1), loc(i.arg2), 0}; break;
+    case instruction::_LOAD   :
+      // booleans are loaded as "x = 1" / "x = 0"
+      if (i.arg2.kind() == operand::_INT)
+        r = {IMM, loc(i.arg1), int32_t(strtoll(i.arg2.str().c_str(), nullptr, 10)), 0};
+      else
+        r = {LOAD, loc(i.arg1), loc(i.arg2), 0};
+      break;
+    case instruction::_ILOAD  :
+      r = {IMM, loc(i.arg1), int32_t(strtoll(i.arg2.str().c_str(), nullptr, 10)), 0}; break;
+    case instruction::_FLOAD  : {
+      slot v; v.f = strtof(i.arg2.str().c_str(), nullptr);
+      r = {IMM, loc(i.arg1), v.i, 0}; break;
+    }
+    case instruction::_CHLOAD : r = {IMM, loc(i.arg1), charValue(i.arg2.str()), 0}; break;
+    case instruction::_XLOAD  : {
+      int32_t base = loc(i.arg1, &direct);
+      r = {direct ? XLOAD_DIRECT : XLOAD_INDIRECT, base, loc(i.arg2), loc(i.arg3)}; break;
+    }
+    case instruction::_LOADX  : {
+      int32_t dst = loc(i.arg1);
+      int32_t base = loc(i.arg2, &direct);
+      r = {direct ? LOADX_DIRECT : LOADX_INDIRECT, dst, base, loc(i.arg3)}; break;
+    }
+    case instruction::_ALOAD  : r = {ALOAD, loc(i.arg1), loc(i.arg2), 0}; break;
+    case instruction::_LOADC  : r = {LOADC, loc(i.arg1), loc(i.arg2), 0}; break;
+    case instruction::_CLOAD  : r = {CLOAD, loc(i.arg1), loc(i.arg2), 0}; break;
+    case instruction::_READI  : r = {READI,  loc(i.arg1), 0, 0}; break;
+    case instruction::_READF  : r = {READF,  loc(i.arg1), 0, 0}; break;
+    case instruction::_READC  : r = {READC,  loc(i.arg1), 0, 0}; break;
+    case instruction::_WRITEI : r = {WRITEI, loc(i.arg1), 0, 0}; break;
+    case instruction::_WRITEF : r = {WRITEF, loc(i.arg1), 0, 0}; break;
+    case instruction::_WRITEC : r = {WRITEC, loc(i.arg1), 0, 0}; break;
+    case instruction::_WRITELN : r = {WRITELN, 0, 0, 0}; break;
+    case instruction::_NOOP   : r = {NOOP, 0, 0, 0}; break;
+    default : return fail("invalid instruction in " + rs.name);
+    }
+    if (not ok) return fail("undefined ID " + undefined + " in " + rs.name);
+    rs.instrs.push_back(r);
+  }
+  // falling off the end of a subroutine returns from it
+  rs.instrs.push_back(rinstruction{RETURN, 0, 0, 0});
+  rs.framesize = size + ntemps;
+  return true;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Execution
+
+// 32-bit integer arithmetic wraps around, as in the tvm
+static inline int32_t wrap(uint32_t v) { return int32_t(v); }
+
+bool interpreter::execute(istream & in, ostream & out) {
+  vector<returnpoint> calls;
+  size_t sub = MainSub;
+  const rinstruction *instrs = Subs[sub].instrs.data();
+  size_t pc = 0;
+  size_t base = 0;
+  size_t sp = Subs[sub].framesize;
+  Memory.assign(sp + 1024, slot{0});
+  slot *M = Memory.data();
+
+  // make room for n more slots over sp
+  auto reserve = [&](size_t n) {
+    if (sp + n > Memory.size()) {
+      Memory.resize(2*(sp + n), slot{0});
+      M = Memory.data();
+    }
+  };
+  // check an absolute address
+  auto valid = [&](int64_t addr) { return addr >= 0 and size_t(addr) < sp; };
+
+#define S(x) M[base + (x)]
+
+  for (;;) {
+    const rinstruction & r = instrs[pc++];
+    ++Executed;
+    switch (r.op) {
+    case UJUMP : pc = r.a; break;
+    case FJUMP : if (not S(r.a).i) pc = r.b; break;
+    case PUSH : reserve(1); M[sp++] = S(r.a); break;
+    case PUSH_EMPTY : reserve(1); M[sp++].i = 0; break;
+    case POP :
+      if (sp <= base + Subs[sub].framesize) return fail("popparam with no parameters in " + Subs[sub].name);
+      S(r.a) = M[--sp]; break;
+    case POP_EMPTY :
+      if (sp <= base + Subs[sub].framesize) return fail("popparam with no parameters in " + Subs[sub].name);
+      --sp; break;
+    case CALL : {
+      const rsubroutine & callee = Subs[r.a];
+      if (sp < base + Subs[sub].framesize + callee.nparams)
+        return fail("not enough parameters pushed to call " + callee.name);
+      calls.push_back(returnpoint{sub, pc, base});
+      sub = r.a;
+      instrs = callee.instrs.data();
+      pc = 0;
+      base = sp;
+      reserve(callee.framesize);
+      for (int32_t k = 0; k < callee.framesize; ++k) M[sp + k].i = 0;
+      sp += callee.framesize;
+      break;
+    }
+    case RETURN : {
+      if (calls.empty()) return true;   // end of main
+      sp = base;
+      const returnpoint & rp = calls.back();
+      sub = rp.sub;
+      instrs = Subs[sub].instrs.data();
+      pc = rp.pc;
+      base = rp.base;
+      calls.pop_back();
+      break;
+    }
+    case ADD : S(r.a).i = wrap(uint32_t(S(r.b).i) + uint32_t(S(r.c).i)); break;
+    case SUB : S(r.a).i = wrap(uint32_t(S(r.b).i) - uint32_t(S(r.c).i)); break;
+    case MUL : S(r.a).i = wrap(uint32_t(S(r.b).i) * uint32_t(S(r.c).i)); break;
+    case DIV : {
+      int32_t d = S(r.c).i;
+      if (d == 0) return fail("division by zero in " + Subs[sub].name);
+      int32_t n = S(r.b).i;
+      S(r.a).i = (d == -1) ? wrap(0u - uint32_t(n)) : n / d;
+      break;
+    }
+    case EQ  : S(r.a).i = S(r.b).i == S(r.c).i; break;
+    case LT  : S(r.a).i = S(r.b).i <  S(r.c).i; break;
+    case LE  : S(r.a).i = S(r.b).i <= S(r.c).i; break;
+    case AND : S(r.a).i = S(r.b).i and S(r.c).i; break;
+    case OR  : S(r.a).i = S(r.b).i or  S(r.c).i; break;
+    case NOT : S(r.a).i = not S(r.b).i; break;
+    case NEG : S(r.a).i = wrap(0u - uint32_t(S(r.b).i)); break;
+    case FLOAT : S(r.a).f = float(S(r.b).i); break;
+    case FADD : S(r.a).f = S(r.b).f + S(r.c).f; break;
+    case FSUB : S(r.a).f = S(r.b).f - S(r.c).f; break;
+    case FMUL : S(r.a).f = S(r.b).f * S(r.c).f; break;
+    case FDIV : S(r.a).f = S(r.b).f / S(r.c).f; break;
+    case FEQ  : S(r.a).i = S(r.b).f == S(r.c).f; break;
+    case FLT  : S(r.a).i = S(r.b).f <  S(r.c).f; break;
+    case FLE  : S(r.a).i = S(r.b).f <= S(r.c).f; break;
+    case FNEG : S(r.a).f = - S(r.b).f; break;
+    case LOAD : S(r.a) = S(r.b); break;
+    case IMM  : S(r.a).i = r.b; break;
+    case XLOAD_DIRECT : {
+      int64_t addr = int64_t(base) + r.a + S(r.b).i;
+      if (not valid(addr)) return fail("invalid array access in " + Subs[sub].name);
+      M[addr] = S(r.c); break;
+    }
+    case XLOAD_INDIRECT : {
+      int64_t addr = int64_t(S(r.a).i) + S(r.b).i;
+      if (not valid(addr)) return fail("invalid array access in " + Subs[sub].name);
+      M[addr] = S(r.c); break;
+    }
+    case LOADX_DIRECT : {
+      int64_t addr = int64_t(base) + r.b + S(r.c).i;
+      if (not valid(addr)) return fail("invalid array access in " + Subs[sub].name);
+      S(r.a) = M[addr]; break;
+    }
+    case LOADX_INDIRECT : {
+      int64_t addr = int64_t(S(r.b).i) + S(r.c).i;
+      if (not valid(addr)) return fail("invalid array access in " + Subs[sub].name);
+      S(r.a) = M[addr]; break;
+    }
+    case ALOAD : S(r.a).i = int32_t(base + r.b); break;
+    case LOADC : {
+      int64_t addr = S(r.b).i;
+      if (not valid(addr)) return fail("invalid memory access in " + Subs[sub].name);
+      S(r.a) = M[addr]; break;
+    }
+    case CLOAD : {
+      int64_t addr = S(r.a).i;
+      if (not valid(addr)) return fail("invalid memory access in " + Subs[sub].name);
+      M[addr] = S(r.b); break;
+    }
+    case READI : { int32_t v = 0; in >> v; S(r.a).i = v; break; }
+    case READF : { float v = 0; in >> v; S(r.a).f = v; break; }
+    case READC : { char v = 0; in >> v; S(r.a).i = (unsigned char)v; break; }
+    case WRITEI : out << S(r.a).i; break;
+    case WRITEF : out << S(r.a).f; break;
+    case WRITEC : out << char(S(r.a).i); break;
+    case WRITELN : out << '\n'; break;
+    case NOOP : break;
+    }
+  }
+
+#undef S
+}
@@ -0,0 +1,126 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    interpreter - In-process execution of t-code for
+//                  the Asl programming language
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+
+//////////////////////////////////////////////////////////////////////
+// Class interpreter: executes a 'code' object directly in memory,
+// with the same semantics as the tvm (t-Code Virtual Machine), so
+// that generated code can be run without writing and re-parsing it.
+//
+// Before running, every subroutine is translated once into a flat
+// vector of resolved instructions: variables, parameters and temps
+// become offsets in the frame, labels become program counters, and
+// called subroutines become indexes. Execution then uses:
+//   - a single memory of 32-bit slots (int, float and char values,
+//     and addresses), used as a stack of frames
+//   - pushparam/popparam working on the top of that memory: the
+//     parameters of a callee are the last slots pushed by the caller
+//   - an explicit stack of return points (no C++ recursion)
+
+class interpreter {
+
+public:
+  // Constructor: the code must outlive the interpreter
+  interpreter(const code & c);
+
+  // Execute the subroutine "main", reading from 'in' and writing
+  // to 'out'. Returns false if a runtime error happens (see getError)
+  bool run(std::istream & in = std::cin, std::ostream & out = std::cout);
+
+  // Description of the last error (empty if there was none)
+  const std::string & getError() const;
+
+  // Number of instructions executed by the last run
+  std::size_t getExecutedInstructions() const;
+
+private:
+  // A memory slot
+  union slot {
+    int32_t i;
+    float   f;
+  };
+
+  // Resolved operations. Array accesses are split in a direct
+  // version (the base is a local array, whose address is known)
+  // and an indirect version (the base is a parameter or a temp
+  // holding an address)
+  enum opcode {
+    UJUMP, FJUMP, PUSH, PUSH_EMPTY, POP, POP_EMPTY, CALL, RETURN,
+    ADD, SUB, MUL, DIV, EQ, LT, LE, NEG, NOT, AND, OR, FLOAT,
+    FADD, FSUB, FMUL, FDIV, FEQ, FLT, FLE, FNEG,
+    LOAD, IMM,
+    XLOAD_DIRECT, XLOAD_INDIRECT, LOADX_DIRECT, LOADX_INDIRECT,
+    ALOAD, LOADC, CLOAD,
+    READI, READF, READC, WRITEI, WRITEF, WRITEC, WRITELN, NOOP
+  };
+
+  // A resolved instruction: frame offsets (negative for parameters),
+  // immediate values, program counters or subroutine indexes
+  struct rinstruction {
+    opcode  op;
+    int32_t a, b, c;
+  };
+
+  // A resolved subroutine
+  struct rsubroutine {
+    std::string               name;
+    std::vector<rinstruction> instrs;
+    // number of parameters, and slots for local vars and temps
+    int32_t                   nparams;
+    int32_t                   framesize;
+  };
+
+  // A return point
+  struct returnpoint {
+    std::size_t sub;
+    std::size_t pc;
+    std::size_t base;
+  };
+
+  // translate all the subroutines (false on error)
+  bool prepare();
+  bool prepare(const subroutine & s, rsubroutine & rs,
+               const std::unordered_map<uint32_t, std::size_t> & subIndex);
+  // execute the resolved program (false on error)
+  bool execute(std::istream & in, std::ostream & out);
+  // record an error
+  bool fail(const std::string & msg);
+
+  const code               & Code;
+  std::vector<rsubroutine>   Subs;
+  std::size_t                MainSub;
+  bool                       Prepared;
+  std::vector<slot>          Memory;
+  std::string                Error;
+  std::size_t                Executed;
+
+};  // class interpreter